@@ -0,0 +1,96 @@
+#include "harness.hpp"
+#include <cstdlib>
+#include <new>
+#include <iomanip>
+
+using namespace std;
+
+static thread_local uint64_t thread_allocations = 0;
+static thread_local uint64_t thread_bytes = 0;
+
+uint64_t allocation_count() { return thread_allocations; }
+uint64_t allocated_bytes() { return thread_bytes; }
+
+static void* counted_allocation(size_t size)
+{
+  void* pointer = malloc(size > 0 ? size : 1);
+
+  if (!pointer)
+    throw bad_alloc();
+  thread_allocations++;
+  thread_bytes += size;
+  return pointer;
+}
+
+// aligned_alloc requires the size to be a multiple of the alignment
+static void* counted_allocation(size_t size, align_val_t alignment)
+{
+  size_t align = static_cast<size_t>(alignment);
+  void* pointer = aligned_alloc(align, size > 0 ? (size + align - 1) / align * align : align);
+
+  if (!pointer)
+    throw bad_alloc();
+  thread_allocations++;
+  thread_bytes += size;
+  return pointer;
+}
+
+void* operator new(size_t size) { return counted_allocation(size); }
+void* operator new[](size_t size) { return counted_allocation(size); }
+void* operator new(size_t size, align_val_t alignment) { return counted_allocation(size, alignment); }
+void* operator new[](size_t size, align_val_t alignment) { return counted_allocation(size, alignment); }
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+void operator delete(void* pointer, align_val_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, align_val_t) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t, align_val_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t, align_val_t) noexcept { free(pointer); }
+
+static string json_escape(const string& source)
+{
+  string result;
+
+  for (char c : source)
+  {
+    if (c == '"' || c == '\\')
+      result += '\\';
+    result += c;
+  }
+  return result;
+}
+
+TwiliBenchmarkRunner::TwiliBenchmarkRunner(int argc, char** argv, ostream& output) : output(output)
+{
+  static const string min_time_option("--min-time=");
+  static const string filter_option("--filter=");
+
+  for (int i = 1 ; i < argc ; ++i)
+  {
+    string argument(argv[i]);
+
+    if (argument.find(min_time_option) == 0)
+      min_time = chrono::milliseconds(stoul(argument.substr(min_time_option.length())));
+    else if (argument.find(filter_option) == 0)
+      filter = argument.substr(filter_option.length());
+  }
+}
+
+bool TwiliBenchmarkRunner::accepts(const string& name, const string& corpus) const
+{
+  return filter.length() == 0 || (name + '/' + corpus).find(filter) != string::npos;
+}
+
+void TwiliBenchmarkRunner::report(const TwiliBenchmarkResult& result)
+{
+  output << fixed
+    << "{\"name\":\"" << json_escape(result.name) << '"'
+    << ",\"corpus\":\"" << json_escape(result.corpus) << '"'
+    << ",\"iterations\":" << result.iterations
+    << ",\"ns_per_op\":" << setprecision(1) << result.ns_per_op
+    << ",\"allocations_per_op\":" << setprecision(2) << result.allocations_per_op
+    << ",\"bytes_per_op\":" << setprecision(1) << result.bytes_per_op
+    << '}' << endl;
+  results.push_back(result);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+// Calls to the global operator new made by the current thread, and the
+// bytes they requested. harness.cpp replaces the global operators, aligned
+// forms included, to keep these counters.
+std::uint64_t allocation_count();
+std::uint64_t allocated_bytes();
+
+struct TwiliBenchmarkResult
+{
+  std::string name;
+  std::string corpus;
+  std::size_t iterations = 0;
+  double      ns_per_op = 0;
+  double      allocations_per_op = 0;
+  double      bytes_per_op = 0;
+};
+
+// Runs each benchmark with a doubling number of iterations until a run lasts
+// at least the minimum time, and reports the last run as one JSON object
+// per line. Options: --min-time=<milliseconds> and --filter=<substring>,
+// which matches on "name/corpus".
+class TwiliBenchmarkRunner
+{
+  std::chrono::nanoseconds          min_time{std::chrono::milliseconds(200)};
+  std::string                       filter;
+  std::ostream&                     output;
+  std::vector<TwiliBenchmarkResult> results;
+
+  void report(const TwiliBenchmarkResult&);
+public:
+  TwiliBenchmarkRunner(int argc, char** argv, std::ostream& output);
+
+  bool accepts(const std::string& name, const std::string& corpus) const;
+  const std::vector<TwiliBenchmarkResult>& get_results() const { return results; }
+
+  // `operation` gets called with the iteration index, which can be used to
+  // walk through a corpus.
+  template<typename OPERATION>
+  void run(const std::string& name, const std::string& corpus, OPERATION operation)
+  {
+    TwiliBenchmarkResult result;
+    std::chrono::nanoseconds elapsed{0};
+
+    if (!accepts(name, corpus))
+      return ;
+    result.name = name;
+    result.corpus = corpus;
+    operation(0); // warm-up
+    for (std::size_t iterations = 1 ; elapsed < min_time ; iterations *= 2)
+    {
+      std::uint64_t allocations = allocation_count();
+      std::uint64_t bytes = allocated_bytes();
+      auto start = std::chrono::steady_clock::now();
+
+      for (std::size_t i = 0 ; i < iterations ; ++i)
+        operation(i);
+      elapsed = std::chrono::steady_clock::now() - start;
+      result.iterations = iterations;
+      result.ns_per_op = static_cast<double>(elapsed.count()) / iterations;
+      result.allocations_per_op = static_cast<double>(allocation_count() - allocations) / iterations;
+      result.bytes_per_op = static_cast<double>(allocated_bytes() - bytes) / iterations;
+    }
+    report(result);
+  }
+};
+
+// Keeps the compiler from optimizing away results which are never read.
+template<typename T>
+inline void do_not_optimize(const T& value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
@@ -0,0 +1,76 @@
+#include "harness.hpp"
+#include <libtwili/registry.hpp>
+#include <thread>
+#include <random>
+#include <iostream>
+
+using namespace std;
+
+static vector<vector<size_t>> make_orders(unsigned int thread_count, size_t key_count)
+{
+  vector<vector<size_t>> orders(thread_count, vector<size_t>(key_count));
+
+  for (unsigned int t = 0 ; t < thread_count ; ++t)
+  {
+    for (size_t i = 0 ; i < key_count ; ++i)
+      orders[t][i] = i;
+    shuffle(orders[t].begin(), orders[t].end(), mt19937(t));
+  }
+  return orders;
+}
+
+// Every thread inserts the same keys in its own order, then looks all of
+// them up, so that most inserts race against another thread's. One
+// operation is a whole race on a fresh registry; only the allocations of
+// the calling thread are counted, which excludes the inserted nodes.
+static void run_race(unsigned int thread_count, const vector<string>& keys, const vector<vector<size_t>>& orders)
+{
+  TwiliConcurrentRegistry<size_t> registry(keys.size());
+  vector<thread> threads;
+
+  for (unsigned int t = 0 ; t < thread_count ; ++t)
+  {
+    threads.emplace_back([&registry, &keys, &orders, t]()
+    {
+      size_t found = 0;
+
+      for (size_t i : orders[t])
+        registry.insert(keys[i], i);
+      for (size_t i : orders[t])
+        found += registry.find(keys[i]) ? 1 : 0;
+      do_not_optimize(found);
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+}
+
+// Besides the harness options, --keys=<count> sets how many keys each
+// thread inserts.
+int main(int argc, char** argv)
+{
+  static const string keys_option("--keys=");
+  TwiliBenchmarkRunner runner(argc, argv, cout);
+  size_t key_count = 100000;
+  vector<string> keys;
+
+  for (int i = 1 ; i < argc ; ++i)
+  {
+    string argument(argv[i]);
+
+    if (argument.find(keys_option) == 0)
+      key_count = stoul(argument.substr(keys_option.length()));
+  }
+  for (size_t i = 0 ; i < key_count ; ++i)
+    keys.push_back("::namespace_" + to_string(i % 97) + "::Type" + to_string(i));
+  for (unsigned int thread_count = 1 ; thread_count <= 32 ; thread_count *= 2)
+  {
+    vector<vector<size_t>> orders = make_orders(thread_count, key_count);
+
+    runner.run("TwiliConcurrentRegistry::insert+find", "keys-" + to_string(key_count) + "/threads-" + to_string(thread_count), [&](size_t)
+    {
+      run_race(thread_count, keys, orders);
+    });
+  }
+  return 0;
+}
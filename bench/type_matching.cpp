@@ -0,0 +1,241 @@
+#include "harness.hpp"
+#include <libtwili/definitions.hpp>
+#include <iostream>
+
+using namespace std;
+
+std::string parse_template_parameter(int& i, const std::string& src, const std::vector<TypeDefinition>& known_types);
+
+// Spellings as found in the signatures of real-world headers.
+static const vector<string> spellings{
+  "std::string",
+  "const std::string&",
+  "std::vector<std::string>",
+  "const std::vector<TypeDefinition>&",
+  "std::map<std::string, HeaderDefinition>",
+  "std::optional<ParamDefinition>",
+  "std::unique_ptr<TwiliParser>",
+  "std::shared_ptr<geo::Shape>",
+  "const geo::Point&",
+  "geo::Box<geo::Point>*",
+  "std::function<void(int)>",
+  "std::pair<const std::string, std::size_t>",
+  "std::unordered_map<CXCursor, std::size_t, CursorHash, CursorEqual>",
+  "Crails::Renderer&",
+  "std::chrono::milliseconds",
+  "std::vector<std::pair<std::string, long long>>",
+  "QList<QSharedPointer<Widget>>",
+  "boost::asio::ip::tcp::socket&",
+  "Eigen::Matrix<double, 3, 3>",
+  "const std::list<std::string>&",
+  "std::filesystem::path",
+  "std::tuple<int, std::string, geo::Point>",
+  "std::atomic<std::uint64_t>",
+  "geo::detail::Impl&&",
+  "std::basic_string<char, std::char_traits<char>>"
+};
+
+static const vector<string> declaration_scope{"geo", "render"};
+
+static const char* param_source =
+  "namespace std { struct string {}; template<typename T> struct vector {}; template<typename K, typename V> struct map {}; }\n"
+  "namespace geo { struct Point {}; template<typename T> struct Box {}; struct Shape {}; namespace detail { struct Impl {}; } }\n"
+  "void f(int, const char*, std::string, const std::string&, std::vector<std::string>, std::map<std::string, geo::Point>*,\n"
+  "       geo::Box<geo::Point>&, const geo::Shape* const, geo::detail::Impl&&, unsigned long);\n";
+
+static TypeDefinition make_type(const string& scope, const string& name, TypeKind kind)
+{
+  TypeDefinition type;
+
+  type.name = name;
+  type.kind = kind;
+  if (scope.length())
+    type.scopes = {scope};
+  type.type_full_name = (scope.length() ? "::" + scope : string()) + "::" + name;
+  return type;
+}
+
+// Synthetic types spread over namespaces and nested scopes, with the types
+// the corpus refers to interleaved, so that lookups scan realistic lengths.
+static vector<TypeDefinition> make_registry(size_t size)
+{
+  static const vector<pair<string, string>> known{
+    {"std", "string"}, {"std", "vector"}, {"std", "map"}, {"geo", "Point"}, {"geo", "Box"}, {"geo", "Shape"},
+    {"", "TypeDefinition"}, {"", "HeaderDefinition"}, {"", "ParamDefinition"}, {"", "TwiliParser"}
+  };
+  vector<TypeDefinition> registry;
+  size_t stride = max<size_t>(1, size / known.size());
+
+  registry.reserve(size);
+  for (size_t i = 0 ; i < size ; ++i)
+  {
+    if (i % stride == stride / 2 && i / stride < known.size())
+    {
+      const auto& entry = known[i / stride];
+
+      registry.push_back(make_type(entry.first, entry.second, ClassKind));
+    }
+    else
+    {
+      TypeDefinition type = make_type("ns" + to_string(i % 64), "Type" + to_string(i), i % 10 == 0 ? TypedefKind : ClassKind);
+
+      if (i % 5 == 0)
+      {
+        type.scopes.push_back("detail");
+        type.type_full_name = "::ns" + to_string(i % 64) + "::detail::Type" + to_string(i);
+      }
+      registry.push_back(type);
+    }
+  }
+  return registry;
+}
+
+static vector<TypeDefinition> make_lookups()
+{
+  vector<TypeDefinition> lookups;
+
+  for (const string& spelling : spellings)
+  {
+    TypeDefinition type;
+
+    type.load_from(spelling, {});
+    type.declaration_scope = declaration_scope;
+    lookups.push_back(type);
+  }
+  return lookups;
+}
+
+static vector<MethodDefinition> make_methods(const vector<TypeDefinition>& registry)
+{
+  vector<MethodDefinition> methods;
+
+  for (size_t i = 0 ; i + 2 < spellings.size() ; ++i)
+  {
+    MethodDefinition method;
+
+    method.name = i % 3 == 0 ? "update" : "render";
+    for (size_t j = i ; j < i + 3 ; ++j)
+    {
+      ParamDefinition& param = method.params.emplace_back();
+
+      param.load_spelled_type(spellings[j], declaration_scope);
+      param.resolve_type(registry);
+    }
+    methods.push_back(method);
+  }
+  return methods;
+}
+
+static vector<CXType> load_param_types(CXTranslationUnit& unit, CXIndex index)
+{
+  const char* args[] = {"-x", "c++", "-std=c++17"};
+  CXUnsavedFile file{"bench.cpp", param_source, static_cast<unsigned long>(char_traits<char>::length(param_source))};
+  vector<CXType> types;
+
+  unit = clang_parseTranslationUnit(index, "bench.cpp", args, 3, &file, 1, CXTranslationUnit_None);
+  if (!unit)
+    return types;
+  clang_visitChildren(clang_getTranslationUnitCursor(unit), [](CXCursor cursor, CXCursor, CXClientData data)
+  {
+    if (clang_getCursorKind(cursor) == CXCursor_FunctionDecl)
+    {
+      auto& types = *reinterpret_cast<vector<CXType>*>(data);
+
+      for (int i = 0 ; i < clang_Cursor_getNumArguments(cursor) ; ++i)
+        types.push_back(clang_getCursorType(clang_Cursor_getArgument(cursor, i)));
+    }
+    return CXChildVisit_Continue;
+  }, &types);
+  return types;
+}
+
+static void run_registry_benchmarks(TwiliBenchmarkRunner& runner, size_t size, const vector<CXType>& param_types)
+{
+  const vector<TypeDefinition> registry = make_registry(size);
+  vector<TypeDefinition> lookups = make_lookups();
+  vector<string> templates;
+  string corpus = "registry-" + to_string(size);
+
+  for (const string& spelling : spellings)
+  {
+    if (spelling.find('<') != string::npos)
+      templates.push_back(spelling);
+  }
+  runner.run("TypeDefinition::load_from", corpus, [&](size_t i)
+  {
+    TypeDefinition type;
+
+    type.load_from(spellings[i % spellings.size()], registry);
+    do_not_optimize(type.name);
+  });
+  runner.run("parse_template_parameter", corpus, [&](size_t i)
+  {
+    const string& spelling = templates[i % templates.size()];
+    int position = spelling.find('<');
+
+    do_not_optimize(parse_template_parameter(position, spelling, registry));
+  });
+  runner.run("TypeDefinition::find_parent_type", corpus, [&](size_t i)
+  {
+    do_not_optimize(lookups[i % lookups.size()].find_parent_type(registry));
+  });
+  if (param_types.size() > 0)
+  {
+    runner.run("ParamDefinition::initialize_type", corpus, [&](size_t i)
+    {
+      ParamDefinition param(param_types[i % param_types.size()], registry);
+
+      do_not_optimize(param);
+    });
+  }
+}
+
+static void run_pair_benchmarks(TwiliBenchmarkRunner& runner)
+{
+  const vector<TypeDefinition> registry = make_registry(1000);
+  vector<TypeDefinition> lookups = make_lookups();
+  vector<TypeDefinition> candidates;
+  vector<MethodDefinition> methods = make_methods(registry);
+  vector<MethodDefinition> copies = methods;
+
+  for (const auto& lookup : lookups)
+  {
+    TypeDefinition exact = lookup;
+    TypeDefinition scoped = lookup;
+
+    exact.declaration_scope.clear();
+    scoped.scopes.insert(scoped.scopes.begin(), declaration_scope.begin(), declaration_scope.end());
+    candidates.push_back(exact);
+    candidates.push_back(scoped);
+  }
+  runner.run("TypeDefinition::type_match", "spellings", [&](size_t i)
+  {
+    do_not_optimize(lookups[i % lookups.size()].type_match(candidates[i % candidates.size()]));
+  });
+  runner.run("MethodDefinition::operator==", "equal", [&](size_t i)
+  {
+    do_not_optimize(methods[i % methods.size()] == copies[i % copies.size()]);
+  });
+  runner.run("MethodDefinition::operator==", "overloads", [&](size_t i)
+  {
+    do_not_optimize(methods[i % methods.size()] == methods[(i + 3) % methods.size()]);
+  });
+}
+
+int main(int argc, char** argv)
+{
+  TwiliBenchmarkRunner runner(argc, argv, cout);
+  CXIndex index = clang_createIndex(0, 0);
+  CXTranslationUnit unit = nullptr;
+  vector<CXType> param_types = load_param_types(unit, index);
+
+  if (param_types.size() == 0)
+    cerr << "(!) Could not parse the parameter corpus, skipping ParamDefinition::initialize_type" << endl;
+  run_pair_benchmarks(runner);
+  for (size_t size : {1000, 10000, 100000})
+    run_registry_benchmarks(runner, size, param_types);
+  if (unit)
+    clang_disposeTranslationUnit(unit);
+  clang_disposeIndex(index);
+  return 0;
+}
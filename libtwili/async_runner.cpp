@@ -0,0 +1,51 @@
+#include "async_runner.hpp"
+
+using namespace std;
+
+TwiliScanProgress TwiliScanHandle::progress() const
+{
+  TwiliScanProgress snapshot;
+
+  snapshot.files_total = monitor->files_total.load(memory_order_relaxed);
+  snapshot.files_done = monitor->files_done.load(memory_order_relaxed);
+  snapshot.cursors_visited = monitor->cursors_visited.load(memory_order_relaxed);
+  snapshot.symbols_found = monitor->symbols_found.load(memory_order_relaxed);
+  snapshot.cancelled = monitor->cancelled.load(memory_order_relaxed);
+  return snapshot;
+}
+
+TwiliScanHandle run_parser_async(TwiliParser& parser, const vector<filesystem::path>& files, const TwiliRunOptions& options, const vector<string>& arguments)
+{
+  auto monitor = make_shared<TwiliScanMonitor>();
+  TwiliRunOptions quiet_options = options;
+
+  quiet_options.verbose = false;
+  monitor->files_total.store(files.size(), memory_order_relaxed);
+  auto result = async(launch::async, [&parser, files, quiet_options, arguments, monitor]()
+  {
+    vector<const char*> argv;
+
+    for (const string& argument : arguments)
+      argv.push_back(argument.c_str());
+    parser.set_verbose(false);
+    parser.set_monitor(monitor.get());
+    try
+    {
+      TwiliRunReport report = run_parser(parser, files, quiet_options, argv.size(), argv.data());
+
+      parser.set_monitor(nullptr);
+      return report;
+    }
+    catch (...)
+    {
+      parser.set_monitor(nullptr);
+      throw ;
+    }
+  });
+  return TwiliScanHandle(monitor, std::move(result));
+}
+
+TwiliScanHandle probe_and_run_parser_async(TwiliParser& parser, const TwiliRunOptions& options, const vector<string>& arguments)
+{
+  return run_parser_async(parser, probe_files(parser), options, arguments);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "runner.hpp"
+#include <future>
+#include <memory>
+
+struct TwiliScanProgress
+{
+  std::size_t   files_total = 0;
+  std::size_t   files_done = 0;
+  std::uint64_t cursors_visited = 0;
+  std::size_t   symbols_found = 0;
+  bool          cancelled = false;
+};
+
+class TwiliScanHandle
+{
+  std::shared_ptr<TwiliScanMonitor> monitor;
+  std::future<TwiliRunReport>       result;
+public:
+  TwiliScanHandle(std::shared_ptr<TwiliScanMonitor> monitor, std::future<TwiliRunReport> result) : monitor(monitor), result(std::move(result)) {}
+
+  void                         cancel() { monitor->cancelled.store(true, std::memory_order_relaxed); }
+  bool                         is_cancelled() const { return monitor->cancelled.load(std::memory_order_relaxed); }
+  TwiliScanProgress            progress() const;
+  std::future<TwiliRunReport>& get_future() { return result; }
+  TwiliRunReport               get() { return result.get(); }
+};
+
+// Runs the scan on its own thread, without writing anything to the standard
+// outputs. The parser must outlive the scan, and must not be used until the
+// future is ready.
+TwiliScanHandle run_parser_async(TwiliParser&, const std::vector<std::filesystem::path>&, const TwiliRunOptions&, const std::vector<std::string>& arguments = {});
+TwiliScanHandle probe_and_run_parser_async(TwiliParser&, const TwiliRunOptions&, const std::vector<std::string>& arguments = {});
@@ -1,4 +1,157 @@
 #include "definitions.hpp"
+#include <algorithm>
+
+using namespace std;
+
+struct RecordVisit
+{
+  RecordTraits&      traits;
+  RecordTraitsCache& cache;
+};
+
+static RecordTraits traits_of(CXType type, RecordTraitsCache& cache);
+
+static bool is_deleted(CXCursor cursor)
+{
+#if CINDEX_VERSION_MINOR >= 63
+  return clang_CXXMethod_isDeleted(cursor);
+#else
+  return false;
+#endif
+}
+
+static bool is_user_provided(CXCursor cursor)
+{
+  return !clang_CXXMethod_isDefaulted(cursor) && !is_deleted(cursor);
+}
+
+static void merge_member_traits(RecordTraits& traits, CXType type, RecordTraitsCache& cache)
+{
+  while (type.kind == CXType_ConstantArray)
+    type = clang_getArrayElementType(type);
+  if (type.kind == CXType_LValueReference || type.kind == CXType_RValueReference)
+    traits.standard_layout = false;
+  else if (type.kind == CXType_Record)
+  {
+    RecordTraits member = traits_of(type, cache);
+
+    traits.trivially_copyable = traits.trivially_copyable && member.trivially_copyable;
+    traits.standard_layout = traits.standard_layout && member.standard_layout;
+  }
+}
+
+static CXChildVisitResult visit_record_member(CXCursor cursor, CXCursor, CXClientData data)
+{
+  RecordVisit& visit = *reinterpret_cast<RecordVisit*>(data);
+  RecordTraits& traits = visit.traits;
+  MethodDefinition method;
+
+  switch (clang_getCursorKind(cursor))
+  {
+    case CXCursor_CXXBaseSpecifier:
+    {
+      RecordTraits base = traits_of(clang_getCanonicalType(clang_getCursorType(cursor)), visit.cache);
+
+      if (clang_isVirtualBase(cursor))
+        traits.trivially_copyable = traits.standard_layout = false;
+      traits.trivially_copyable = traits.trivially_copyable && base.trivially_copyable;
+      traits.standard_layout = traits.standard_layout && base.standard_layout;
+      traits.classes_with_fields += base.classes_with_fields;
+      break ;
+    }
+    case CXCursor_FieldDecl:
+    {
+      CX_CXXAccessSpecifier access = clang_getCXXAccessSpecifier(cursor);
+
+      if (!traits.has_own_fields)
+      {
+        traits.has_own_fields = true;
+        traits.field_access = access;
+        traits.classes_with_fields++;
+      }
+      else if (access != traits.field_access)
+        traits.standard_layout = false;
+      merge_member_traits(traits, clang_getCanonicalType(clang_getCursorType(cursor)), visit.cache);
+      break ;
+    }
+    case CXCursor_Destructor:
+      if (clang_CXXMethod_isVirtual(cursor))
+        traits.standard_layout = false;
+      if (!clang_CXXMethod_isDefaulted(cursor))
+        traits.trivially_copyable = false;
+      break ;
+    case CXCursor_Constructor:
+    case CXCursor_CXXMethod:
+      method.load_traits(cursor);
+      if (clang_CXXMethod_isVirtual(cursor))
+        traits.trivially_copyable = traits.standard_layout = false;
+      else if (method.special_member != NoSpecialMember && method.special_member != DefaultConstructor && is_user_provided(cursor))
+        traits.trivially_copyable = false;
+      break ;
+    default:
+      break ;
+  }
+  return CXChildVisit_Continue;
+}
+
+static RecordTraits traits_of(CXType type, RecordTraitsCache& cache)
+{
+  RecordTraits traits;
+  RecordVisit visit{traits, cache};
+  CXCursor declaration = clang_getTypeDeclaration(type);
+  CXCursor definition = clang_getCursorDefinition(declaration);
+
+  // libclang doesn't expose the members of implicit template instantiations,
+  // so these are conservatively considered as neither trivially copyable
+  // nor standard layout.
+  if (clang_Cursor_isNull(definition) || !clang_Cursor_isNull(clang_getSpecializedCursorTemplate(declaration)))
+    traits.trivially_copyable = traits.standard_layout = false;
+  else
+  {
+    auto cached = cache.find(definition);
+
+    if (cached != cache.end())
+      return cached->second;
+    clang_visitChildren(definition, &visit_record_member, &visit);
+  }
+  traits.standard_layout = traits.standard_layout && traits.classes_with_fields <= 1;
+  if (!clang_Cursor_isNull(definition))
+    cache.emplace(definition, traits);
+  return traits;
+}
+
+void ClassDefinition::load_traits(CXType type, RecordTraitsCache& cache)
+{
+  if (layout.is_known())
+  {
+    RecordTraits traits = traits_of(clang_getCanonicalType(type), cache);
+
+    is_trivially_copyable = traits.trivially_copyable;
+    is_standard_layout = traits.standard_layout;
+  }
+}
+
+const MethodDefinition* ClassDefinition::find_special_member(SpecialMemberKind kind) const
+{
+  const auto& list = kind == CopyAssignment || kind == MoveAssignment ? methods : constructors;
+
+  for (const auto& method : list)
+  {
+    if (method.special_member == kind)
+      return &method;
+  }
+  return nullptr;
+}
+
+bool ClassDefinition::is_polymorphic() const
+{
+  return std::any_of(methods.begin(), methods.end(), [](const MethodDefinition& method) { return method.is_virtual; });
+}
+
+bool ClassDefinition::is_abstract() const
+{
+  return std::any_of(methods.begin(), methods.end(), [](const MethodDefinition& method) { return method.is_pure_virtual; });
+}
 
 bool ClassDefinition::implements(const MethodDefinition& method) const
 {
@@ -0,0 +1,81 @@
+#include "crossreference.hpp"
+#include <algorithm>
+#include <functional>
+
+using namespace std;
+
+static const vector<TypeUsage> no_usages;
+static const vector<DeclaredSymbol> no_symbols;
+
+void TwiliCrossReference::add_usage(const string& type_name, const TypeUsage& usage)
+{
+  for (const string& name : type_names_in(type_name))
+    usages[name].push_back(usage);
+}
+
+void TwiliCrossReference::add_symbol(const string& path, const DeclaredSymbol& symbol)
+{
+  if (path.length() > 0)
+    symbols[path].push_back(symbol);
+}
+
+static void index_invokable(const InvokableDefinition& invokable, const string& owner, const string& member, const function<void(const string&, const TypeUsage&)>& add)
+{
+  if (invokable.return_type)
+    add(*invokable.return_type, {TypeUsage::ReturnUsage, owner, member});
+  for (size_t i = 0 ; i < invokable.params.size() ; ++i)
+    add(invokable.params[i], {TypeUsage::ParamUsage, owner, member, i});
+}
+
+TwiliCrossReference::TwiliCrossReference(const TwiliParser& parser)
+{
+  auto add = [this](const string& type_name, const TypeUsage& usage) { add_usage(type_name, usage); };
+
+  for (const auto& klass : parser.get_classes())
+  {
+    DeclaredSymbol symbol{DeclaredSymbol::ClassSymbol, klass.full_name};
+
+    add_symbol(klass.from_file, symbol);
+    if (klass.include_path != klass.from_file)
+      add_symbol(klass.include_path, symbol);
+    for (const auto& base : klass.bases)
+      add_usage(base, {TypeUsage::BaseUsage, klass.full_name, string()});
+    for (const auto& constructor : klass.constructors)
+      index_invokable(constructor, klass.full_name, klass.name, add);
+    for (const auto& method : klass.methods)
+      index_invokable(method, klass.full_name, method.name, add);
+    for (const auto& field : klass.fields)
+      add_usage(field, {TypeUsage::FieldUsage, klass.full_name, field.name});
+  }
+  for (const auto& definition : parser.get_enums())
+  {
+    DeclaredSymbol symbol{DeclaredSymbol::EnumSymbol, definition.full_name};
+
+    add_symbol(definition.from_file, symbol);
+    if (definition.include_path != definition.from_file)
+      add_symbol(definition.include_path, symbol);
+  }
+  for (const auto& function : parser.get_functions())
+  {
+    DeclaredSymbol symbol{DeclaredSymbol::FunctionSymbol, function.full_name};
+
+    add_symbol(function.from_file, symbol);
+    if (function.include_path != function.from_file)
+      add_symbol(function.include_path, symbol);
+    index_invokable(function, function.full_name, function.name, add);
+  }
+}
+
+const vector<TypeUsage>& TwiliCrossReference::users_of(const string& type_full_name) const
+{
+  auto it = usages.find(type_full_name);
+
+  return it != usages.end() ? it->second : no_usages;
+}
+
+const vector<DeclaredSymbol>& TwiliCrossReference::declared_in(const string& path) const
+{
+  auto it = symbols.find(path);
+
+  return it != symbols.end() ? it->second : no_symbols;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "parser.hpp"
+#include <unordered_map>
+
+struct TypeUsage
+{
+  enum Kind
+  {
+    ParamUsage,
+    ReturnUsage,
+    FieldUsage,
+    BaseUsage
+  };
+
+  Kind        kind;
+  std::string owner;      // full name of the class or function
+  std::string member;     // method, constructor or field name
+  std::size_t index = 0;  // position of the parameter
+};
+
+struct DeclaredSymbol
+{
+  enum Kind
+  {
+    ClassSymbol,
+    EnumSymbol,
+    FunctionSymbol
+  };
+
+  Kind        kind;
+  std::string full_name;
+};
+
+// Inverted indexes built once from a parsed model. Types used as template
+// arguments are indexed as well, so that a `std::vector<::foo::Bar>`
+// parameter also counts as a use of `::foo::Bar`. Files are indexed by both
+// their path and their include path.
+class TwiliCrossReference
+{
+  std::unordered_map<std::string, std::vector<TypeUsage>>      usages;
+  std::unordered_map<std::string, std::vector<DeclaredSymbol>> symbols;
+
+  void add_usage(const std::string& type_name, const TypeUsage&);
+  void add_symbol(const std::string& path, const DeclaredSymbol&);
+public:
+  TwiliCrossReference(const TwiliParser&);
+
+  const std::vector<TypeUsage>&      users_of(const std::string& type_full_name) const;
+  const std::vector<DeclaredSymbol>& declared_in(const std::string& path) const;
+};
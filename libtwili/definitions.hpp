@@ -2,9 +2,38 @@
 #include <string>
 #include <optional>
 #include <vector>
+#include <array>
+#include <cstdint>
 #include <unordered_map>
 #include <clang-c/Index.h>
 
+struct CursorHash
+{
+  std::size_t operator()(const CXCursor& cursor) const { return clang_hashCursor(cursor); }
+};
+
+struct CursorEqual
+{
+  bool operator()(const CXCursor& a, const CXCursor& b) const { return clang_equalCursors(a, b); }
+};
+
+template<typename VALUE>
+using CursorMap = std::unordered_map<CXCursor, VALUE, CursorHash, CursorEqual>;
+
+// Bit mask of the configurations in which a symbol was found, only set by
+// run_multi_config_parser.
+typedef std::uint64_t ConfigurationMask;
+
+enum SpecialMemberKind
+{
+  NoSpecialMember = 0,
+  DefaultConstructor,
+  CopyConstructor,
+  MoveConstructor,
+  CopyAssignment,
+  MoveAssignment
+};
+
 struct TemplateParameter
 {
   std::string type;
@@ -23,6 +52,52 @@ enum TypeKind
   NamespaceKind
 };
 
+// Type tree built straight from libclang: pointer and reference layers are
+// kept in fixed-size storage, from the outermost to the innermost one, and
+// the scope path comes from the declaration's semantic parents. Names,
+// scopes and template arguments are still heap-allocated when they don't
+// fit in the small string buffer: references are short-lived, and only
+// built to be spelled into parameters and type definitions.
+struct TypeReference
+{
+  static const unsigned char max_layers = 8;
+
+  enum LayerKind : unsigned char
+  {
+    PointerLayer,
+    LValueReferenceLayer,
+    RValueReferenceLayer
+  };
+
+  struct Layer
+  {
+    LayerKind kind;
+    bool      is_const;
+  };
+
+  CXTypeKind                    kind = CXType_Invalid;
+  bool                          is_const = false;
+  unsigned char                 layer_count = 0;
+  std::array<Layer, max_layers> layers;
+  std::string                   name;
+  std::vector<std::string>      scopes;
+  std::vector<TypeReference>    template_arguments;
+
+  TypeReference() {}
+  TypeReference(CXType);
+
+  bool        is_builtin() const;
+  bool        is_spelled() const; // function and array types, declarators included
+  int         pointer_count() const;
+  int         reference_count() const;
+  std::string unqualified_name() const;
+  std::string full_name() const;
+  std::string to_string() const;
+};
+
+const std::string* builtin_type_name(CXTypeKind);
+bool               is_builtin_type_name(const std::string&);
+
 struct TypeDefinition
 {
   std::string              raw_name;
@@ -40,23 +115,48 @@ struct TypeDefinition
   unsigned char   type_match(const TypeDefinition&) const;
   std::string     solve_type(const std::vector<TypeDefinition>& known_types);
   std::optional<TypeDefinition> find_parent_type(const std::vector<TypeDefinition>& known_types);
+  std::string     scoped_name() const;
   std::string     to_string() const;
   std::string     to_full_name() const;
 };
 
+// Sizes and alignments are in bytes, offsets are in bits, and values which
+// libclang couldn't compute (such as in templates) are left negative.
+struct LayoutDefinition
+{
+  long long size = -1;
+  long long alignment = -1;
+  long long offset = -1;
+  int       bit_width = -1;
+
+  bool is_known() const { return size >= 0 && alignment > 0; }
+  bool is_bit_field() const { return bit_width >= 0; }
+};
+
+// A file seen while parsing, and the files it directly includes.
+struct HeaderDefinition
+{
+  std::string              path;
+  std::size_t              size = 0;
+  std::vector<std::string> includes;
+};
+
 struct EnumDefinition
 {
   std::string name;
   std::string full_name;
   std::string from_file;
+  std::string include_path;
+  std::string visibility = "public";
   std::vector<std::pair<std::string, long long>> flags;
+  ConfigurationMask configurations = 0;
 };
 
 struct ParamDefinition : public std::string
 {
   ParamDefinition() {}
-  ParamDefinition(CXCursor cursor, const std::vector<TypeDefinition>& known_types);
-  ParamDefinition(CXType type, const std::vector<TypeDefinition>& known_types);
+  ParamDefinition(CXCursor cursor, const std::vector<TypeDefinition>& known_types, bool deferred = false);
+  ParamDefinition(CXType type, const std::vector<TypeDefinition>& known_types, bool deferred = false);
   ParamDefinition(const std::string& name) : std::string(name) {}
 
   bool        is_const     = false;
@@ -64,20 +164,27 @@ struct ParamDefinition : public std::string
   int         is_pointer   = 0;
   std::string name;
   std::string type_alias;
+  std::optional<TypeDefinition> unresolved_type;
+  bool        is_symbolic = false; // spelled from tokens, and not matched with any known type yet
 
   std::string to_string() const;
+  bool        is_resolved() const { return !unresolved_type; }
+  void        resolve_type(const std::vector<TypeDefinition>& known_types);
+  void        load_spelled_type(const std::string& spelled_type, const std::vector<std::string>& declaration_scope);
 
   bool operator==(const ParamDefinition& other) const { return to_string() == other.to_string(); }
 private:
-  void initialize_type(CXType type, const std::vector<TypeDefinition>& known_types);
+  void initialize_type(CXType type, const std::vector<TypeDefinition>& known_types, bool deferred);
 };
 
 struct FieldDefinition : public ParamDefinition
 {
   FieldDefinition() {}
-  FieldDefinition(CXCursor cursor, const std::vector<TypeDefinition>& known_types) : ParamDefinition(cursor, known_types) {}
+  FieldDefinition(CXCursor cursor, const std::vector<TypeDefinition>& known_types, bool deferred = false) : ParamDefinition(cursor, known_types, deferred) {}
   bool        is_static = false;
   std::string visibility;
+  LayoutDefinition layout;
+  ConfigurationMask configurations = 0;
 
   bool operator==(const FieldDefinition& other) const { return name == other.name; }
 };
@@ -97,9 +204,19 @@ struct MethodDefinition : public InvokableDefinition
   bool               is_virtual = false;
   bool               is_pure_virtual = false;
   bool               is_const = false;
+  bool               is_defaulted = false;
+  bool               is_deleted = false;
+  bool               is_final = false;
+  bool               is_override = false; // only set when spelled out
   std::string        name;
   std::string        visibility;
+  SpecialMemberKind  special_member = NoSpecialMember;
+  CXRefQualifierKind ref_qualifier = CXRefQualifier_None;
+  CXCursor_ExceptionSpecificationKind exception_specification = CXCursor_ExceptionSpecificationKind_None;
+  ConfigurationMask  configurations = 0;
 
+  std::optional<bool> is_noexcept() const; // empty when it depends on an expression which wasn't evaluated
+  void load_traits(CXCursor);
   bool operator==(const MethodDefinition&) const;
 };
 
@@ -109,9 +226,18 @@ struct FunctionDefinition : public InvokableDefinition
   std::string full_name;
   std::string from_file;
   std::string include_path;
+  ConfigurationMask configurations = 0;
   std::string cpp_context() const;
 };
 
+// Returns the scope part of a full name, such as `::a` for `::a::b`.
+std::string scope_of(const std::string& full_name);
+
+// Collects every qualified name appearing in a type, such as both
+// `::std::vector` and `::foo::Bar` in `::std::vector<::foo::Bar>`, function
+// types included.
+std::vector<std::string> type_names_in(const std::string& type);
+
 struct NamespaceDefinition
 {
   std::string name;
@@ -120,6 +246,19 @@ struct NamespaceDefinition
   bool operator==(const std::string& value) const { return full_name == value; }
 };
 
+struct RecordTraits
+{
+  bool                  trivially_copyable = true;
+  bool                  standard_layout = true;
+  unsigned int          classes_with_fields = 0; // within the hierarchy, standard layout allows only one
+  bool                  has_own_fields = false;
+  CX_CXXAccessSpecifier field_access = CX_CXXInvalidAccessSpecifier;
+};
+
+// Traits of the record definitions met within a translation unit, so that
+// bases and members shared by several classes only get walked once.
+typedef CursorMap<RecordTraits> RecordTraitsCache;
+
 struct ClassDefinition : public NamespaceDefinition
 {
   std::string                   type;
@@ -131,7 +270,17 @@ struct ClassDefinition : public NamespaceDefinition
   std::vector<MethodDefinition> methods;
   std::vector<FieldDefinition>  fields;
   TemplateParameters            template_parameters;
+  LayoutDefinition              layout;
+  bool                          is_trivially_copyable = false; // traits are only computed for classes with a known layout
+  bool                          is_standard_layout = false;
+  bool                          is_final = false;
+  bool                          has_definition = false; // only forward declarations were seen otherwise
+  ConfigurationMask             configurations = 0;
+  void load_traits(CXType, RecordTraitsCache&);
+  const MethodDefinition* find_special_member(SpecialMemberKind) const;
   bool is_empty() const { return constructors.size() + methods.size() + bases.size() == 0; }
+  bool is_polymorphic() const;
+  bool is_abstract() const; // only looks at its own methods, not at the pure methods of its bases
   bool is_template() const { return template_parameters.size() > 0; }
   bool implements(const MethodDefinition&) const;
 };
@@ -0,0 +1,174 @@
+#include "devirtualization.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <sstream>
+
+using namespace std;
+
+struct ClassHierarchy
+{
+  vector<ClassDefinition>                      classes;
+  unordered_map<string, size_t>                indexes;
+  unordered_map<string, vector<const ClassDefinition*>> derived;
+  mutable unordered_map<const ClassDefinition*, bool> abstract_classes;
+
+  ClassHierarchy(const TwiliParser& parser) : classes(parser.get_classes())
+  {
+    for (size_t i = 0 ; i < classes.size() ; ++i)
+      indexes.emplace(classes[i].full_name, i);
+    for (const ClassDefinition& klass : classes)
+    {
+      for (const string& base : klass.known_bases)
+        derived[base].push_back(&klass);
+    }
+  }
+
+  const ClassDefinition* find(const string& full_name) const
+  {
+    auto it = indexes.find(full_name);
+
+    return it != indexes.end() ? &classes[it->second] : nullptr;
+  }
+
+  const vector<const ClassDefinition*>& derived_from(const ClassDefinition& klass) const
+  {
+    static const vector<const ClassDefinition*> none;
+    auto it = derived.find(klass.full_name);
+
+    return it != derived.end() ? it->second : none;
+  }
+
+  void collect_descendants(const ClassDefinition& klass, vector<const ClassDefinition*>& descendants) const
+  {
+    for (const ClassDefinition* child : derived_from(klass))
+    {
+      if (find_if(descendants.begin(), descendants.end(), [child](const ClassDefinition* item) { return item == child; }) == descendants.end())
+      {
+        descendants.push_back(child);
+        collect_descendants(*child, descendants);
+      }
+    }
+  }
+
+  bool is_polymorphic(const ClassDefinition& klass, unsigned int depth = 0) const
+  {
+    if (klass.is_polymorphic())
+      return true;
+    for (const string& base_name : klass.known_bases)
+    {
+      const ClassDefinition* base = find(base_name);
+
+      if (base && depth < 64 && is_polymorphic(*base, depth + 1))
+        return true;
+    }
+    return false;
+  }
+
+  // Pure virtual methods, declared by the class or by its bases, which no
+  // class on the way down to it implements.
+  void collect_pure_methods(const ClassDefinition& klass, vector<const MethodDefinition*>& pure_methods, unsigned int depth = 0) const
+  {
+    for (const MethodDefinition& method : klass.methods)
+    {
+      if (method.is_pure_virtual)
+        pure_methods.push_back(&method);
+    }
+    for (const string& base_name : klass.known_bases)
+    {
+      const ClassDefinition* base = find(base_name);
+      vector<const MethodDefinition*> base_methods;
+
+      if (!base || depth >= 64)
+        continue ;
+      collect_pure_methods(*base, base_methods, depth + 1);
+      for (const MethodDefinition* method : base_methods)
+      {
+        if (!klass.implements(*method))
+          pure_methods.push_back(method);
+      }
+    }
+  }
+
+  bool is_abstract(const ClassDefinition& klass) const
+  {
+    auto it = abstract_classes.find(&klass);
+
+    if (it == abstract_classes.end())
+    {
+      vector<const MethodDefinition*> pure_methods;
+
+      collect_pure_methods(klass, pure_methods);
+      it = abstract_classes.emplace(&klass, pure_methods.size() > 0).first;
+    }
+    return it->second;
+  }
+
+  bool is_inherited(const ClassDefinition& klass, const MethodDefinition& method, unsigned int depth = 0) const
+  {
+    for (const string& base_name : klass.known_bases)
+    {
+      const ClassDefinition* base = find(base_name);
+
+      if (base && depth < 64 && (base->implements(method) || is_inherited(*base, method, depth + 1)))
+        return true;
+    }
+    return false;
+  }
+};
+
+static void find_unoverridden_methods(TwiliDevirtualizationReport& report, const ClassHierarchy& hierarchy, const ClassDefinition& klass, const vector<const ClassDefinition*>& descendants)
+{
+  for (const MethodDefinition& method : klass.methods)
+  {
+    if (!method.is_virtual || method.is_pure_virtual || method.is_final)
+      continue ;
+    // methods of leaf classes which override a base are covered by the final candidates
+    if (descendants.empty() && (method.is_override || hierarchy.is_inherited(klass, method)))
+      continue ;
+    if (none_of(descendants.begin(), descendants.end(), [&method](const ClassDefinition* descendant) { return descendant->implements(method); }))
+      report.unoverridden_methods.push_back(klass.full_name + "::" + method.name);
+  }
+}
+
+TwiliDevirtualizationReport analyze_devirtualization(const TwiliParser& parser)
+{
+  TwiliDevirtualizationReport report;
+  ClassHierarchy hierarchy(parser);
+
+  for (const ClassDefinition& klass : hierarchy.classes)
+  {
+    vector<const ClassDefinition*> descendants;
+
+    if (klass.is_template() || !hierarchy.is_polymorphic(klass))
+      continue ;
+    hierarchy.collect_descendants(klass, descendants);
+    if (descendants.empty() && !klass.is_final && !hierarchy.is_abstract(klass))
+      report.final_candidates.push_back(klass.full_name);
+    find_unoverridden_methods(report, hierarchy, klass, descendants);
+    if (hierarchy.is_abstract(klass))
+    {
+      vector<const ClassDefinition*> implementations;
+
+      copy_if(descendants.begin(), descendants.end(), back_inserter(implementations), [&hierarchy](const ClassDefinition* descendant) { return !hierarchy.is_abstract(*descendant); });
+      if (implementations.size() == 1)
+        report.single_implementations.emplace_back(klass.full_name, implementations.front()->full_name);
+    }
+  }
+  return report;
+}
+
+string TwiliDevirtualizationReport::to_string() const
+{
+  stringstream stream;
+
+  stream << final_candidates.size() << " classes could be final";
+  for (const string& name : final_candidates)
+    stream << "\n  " << name;
+  stream << '\n' << unoverridden_methods.size() << " virtual methods are never overridden";
+  for (const string& name : unoverridden_methods)
+    stream << "\n  " << name;
+  stream << '\n' << single_implementations.size() << " interfaces have a single implementation";
+  for (const auto& entry : single_implementations)
+    stream << "\n  " << entry.first << " -> " << entry.second;
+  return stream.str();
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "parser.hpp"
+#include <utility>
+
+struct TwiliDevirtualizationReport
+{
+  std::vector<std::string> final_candidates;     // polymorphic classes which nothing derives from
+  std::vector<std::string> unoverridden_methods; // virtual methods which no derived class overrides
+  std::vector<std::pair<std::string, std::string>> single_implementations; // abstract class and its only concrete descendant
+
+  std::string to_string() const;
+};
+
+// Only sees the hierarchy within the scanned files: a class derived from
+// outside of them won't prevent its bases from being reported. Destructors
+// aren't part of the model, so they aren't taken into account.
+TwiliDevirtualizationReport analyze_devirtualization(const TwiliParser&);
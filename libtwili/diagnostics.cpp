@@ -0,0 +1,108 @@
+#include "diagnostics.hpp"
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+string cxStringToStdString(const CXString&);
+
+static const char* severity_name(CXDiagnosticSeverity severity)
+{
+  switch (severity)
+  {
+    case CXDiagnostic_Note:
+      return "note";
+    case CXDiagnostic_Warning:
+      return "warning";
+    case CXDiagnostic_Error:
+      return "error";
+    case CXDiagnostic_Fatal:
+      return "fatal error";
+    default:
+      break ;
+  }
+  return "ignored";
+}
+
+string TwiliDiagnostic::to_string() const
+{
+  stringstream stream;
+
+  stream << file << ':' << line << ':' << column << ": " << severity_name(severity) << ": " << message;
+  if (category_name.length())
+    stream << " [" << category_name << ']';
+  return stream.str();
+}
+
+vector<const TwiliFileReport*> TwiliRunReport::failures() const
+{
+  vector<const TwiliFileReport*> result;
+
+  for (const auto& file : files)
+  {
+    if (file.has_failed())
+      result.push_back(&file);
+  }
+  return result;
+}
+
+string TwiliRunReport::summary() const
+{
+  stringstream stream;
+  auto failed_files = failures();
+
+  stream << files.size() << " files scanned, " << failed_files.size() << " failed";
+  if (size_t skipped_count = count_if(files.begin(), files.end(), [](const TwiliFileReport& file) { return file.skipped; }))
+    stream << ", " << skipped_count << " skipped";
+  if (cancelled)
+    stream << " (cancelled)";
+  for (const TwiliFileReport* file : failed_files)
+  {
+    stream << "\n  " << file->path;
+    if (!file->parsed)
+      stream << " (could not be parsed, error code " << file->error_code << ')';
+    else
+      stream << " (" << file->error_count << " errors)";
+  }
+  if (unresolved_types.size() > 0)
+  {
+    stream << '\n' << unresolved_types.size() << " unresolved type references";
+    for (const string& type : unresolved_types)
+      stream << "\n  " << type;
+  }
+  return stream.str();
+}
+
+static TwiliDiagnostic make_diagnostic(CXDiagnostic diagnostic, CXDiagnosticSeverity severity)
+{
+  TwiliDiagnostic result;
+  CXFile file = nullptr;
+
+  result.severity = severity;
+  clang_getSpellingLocation(clang_getDiagnosticLocation(diagnostic), &file, &result.line, &result.column, nullptr);
+  if (file)
+    result.file = cxStringToStdString(clang_getFileName(file));
+  result.category = clang_getDiagnosticCategory(diagnostic);
+  result.category_name = cxStringToStdString(clang_getDiagnosticCategoryText(diagnostic));
+  result.message = cxStringToStdString(clang_getDiagnosticSpelling(diagnostic));
+  return result;
+}
+
+void collect_diagnostics(CXTranslationUnit unit, TwiliFileReport& report, CXDiagnosticSeverity minimum_severity)
+{
+  unsigned int count = clang_getNumDiagnostics(unit);
+
+  for (unsigned int i = 0 ; i < count ; ++i)
+  {
+    CXDiagnostic diagnostic = clang_getDiagnostic(unit, i);
+    CXDiagnosticSeverity severity = clang_getDiagnosticSeverity(diagnostic);
+
+    if (severity >= CXDiagnostic_Error)
+      report.error_count++;
+    else if (severity == CXDiagnostic_Warning)
+      report.warning_count++;
+    if (severity >= minimum_severity)
+      report.diagnostics.push_back(make_diagnostic(diagnostic, severity));
+    clang_disposeDiagnostic(diagnostic);
+  }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <clang-c/Index.h>
+
+struct TwiliDiagnostic
+{
+  CXDiagnosticSeverity severity = CXDiagnostic_Ignored;
+  std::string          file;
+  unsigned int         line = 0;
+  unsigned int         column = 0;
+  unsigned int         category = 0;
+  std::string          category_name;
+  std::string          message;
+
+  bool        is_error() const { return severity >= CXDiagnostic_Error; }
+  std::string to_string() const;
+};
+
+struct TwiliFileReport
+{
+  std::string                  path;
+  bool                         parsed = false;
+  CXErrorCode                  error_code = CXError_Success;
+  unsigned int                 error_count = 0;
+  unsigned int                 warning_count = 0;
+  std::vector<TwiliDiagnostic> diagnostics;
+  bool                         errors_expected = false; // single-file parsing cannot see the included declarations
+  bool                         skipped = false; // ruled out by the lexical pre-filter
+
+  bool has_failed() const { return !skipped && (!parsed || (error_count > 0 && !errors_expected)); }
+};
+
+struct TwiliRunReport
+{
+  std::vector<TwiliFileReport> files;
+  std::vector<std::string>     unresolved_types;
+  bool                         cancelled = false;
+
+  std::vector<const TwiliFileReport*> failures() const;
+  bool        success() const { return !cancelled && failures().size() == 0; }
+  std::string summary() const;
+};
+
+// Counts every diagnostic of the unit, but only extracts location and
+// message from those at or above `minimum_severity`.
+void collect_diagnostics(CXTranslationUnit, TwiliFileReport&, CXDiagnosticSeverity minimum_severity);
@@ -0,0 +1,104 @@
+#include "filter.hpp"
+
+using namespace std;
+
+static string normalize_scope(const string& full_name)
+{
+  if (full_name.find("::") != 0)
+    return "::" + full_name;
+  return full_name;
+}
+
+static bool is_within(const string& full_name, const string& scope)
+{
+  return full_name.find(scope) == 0 &&
+    (full_name.length() == scope.length() || full_name.compare(scope.length(), 2, "::") == 0);
+}
+
+static bool is_strictly_within(const string& full_name, const string& scope)
+{
+  return full_name.length() > scope.length() && is_within(full_name, scope);
+}
+
+TwiliFilter& TwiliFilter::allow_namespace(const string& full_name)
+{
+  namespaces.push_back(normalize_scope(full_name));
+  return *this;
+}
+
+TwiliFilter& TwiliFilter::deny_namespace(const string& full_name)
+{
+  excluded_namespaces.push_back(normalize_scope(full_name));
+  return *this;
+}
+
+TwiliFilter& TwiliFilter::allow_symbols(const string& pattern)
+{
+  symbols.push_back(regex(pattern, regex::optimize));
+  return *this;
+}
+
+TwiliFilter& TwiliFilter::deny_symbols(const string& pattern)
+{
+  excluded_symbols.push_back(regex(pattern, regex::optimize));
+  return *this;
+}
+
+TwiliFilter& TwiliFilter::require_access(CX_CXXAccessSpecifier access)
+{
+  minimum_access = access;
+  return *this;
+}
+
+bool TwiliFilter::accepts_namespace(const string& full_name) const
+{
+  for (const string& excluded : excluded_namespaces)
+  {
+    if (is_within(full_name, excluded))
+      return false;
+  }
+  if (namespaces.size() == 0)
+    return true;
+  for (const string& allowed : namespaces)
+  {
+    // Parents of an allowed namespace must be traversed to reach it
+    if (is_within(full_name, allowed) || is_within(allowed, full_name))
+      return true;
+  }
+  return false;
+}
+
+bool TwiliFilter::accepts_symbol(const string& full_name) const
+{
+  bool allowed = namespaces.size() == 0;
+
+  for (const string& excluded : excluded_namespaces)
+  {
+    if (is_strictly_within(full_name, excluded))
+      return false;
+  }
+  for (auto it = namespaces.begin() ; !allowed && it != namespaces.end() ; ++it)
+    allowed = is_strictly_within(full_name, *it);
+  if (!allowed)
+    return false;
+  for (const regex& pattern : excluded_symbols)
+  {
+    if (regex_search(full_name, pattern))
+      return false;
+  }
+  if (symbols.size() == 0)
+    return true;
+  for (const regex& pattern : symbols)
+  {
+    if (regex_search(full_name, pattern))
+      return true;
+  }
+  return false;
+}
+
+bool TwiliFilter::accepts_access(CX_CXXAccessSpecifier access) const
+{
+  if (access == CX_CXXInvalidAccessSpecifier)
+    return true;
+  return access <= minimum_access;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <regex>
+#include <clang-c/Index.h>
+
+// Decides which parts of the scanned headers are worth visiting.
+// Namespaces and symbols are matched against full names such as `::foo::Bar`.
+// An empty allowlist accepts everything that isn't explicitly denied.
+// Symbol patterns apply to classes, enums and functions, while class
+// members are only filtered by their access level.
+struct TwiliFilter
+{
+  std::vector<std::string> namespaces;
+  std::vector<std::string> excluded_namespaces;
+  std::vector<std::regex>  symbols;
+  std::vector<std::regex>  excluded_symbols;
+  CX_CXXAccessSpecifier    minimum_access = CX_CXXPrivate;
+
+  TwiliFilter& allow_namespace(const std::string& full_name);
+  TwiliFilter& deny_namespace(const std::string& full_name);
+  TwiliFilter& allow_symbols(const std::string& pattern);
+  TwiliFilter& deny_symbols(const std::string& pattern);
+  TwiliFilter& require_access(CX_CXXAccessSpecifier access);
+
+  bool accepts_namespace(const std::string& full_name) const;
+  bool accepts_symbol(const std::string& full_name) const;
+  bool accepts_access(CX_CXXAccessSpecifier access) const;
+};
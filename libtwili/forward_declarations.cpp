@@ -0,0 +1,198 @@
+#include "forward_declarations.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <sstream>
+
+using namespace std;
+
+typedef unordered_map<string, bool> TypeUsages; // type full name, and whether it must be complete
+
+static void add_usage(TypeUsages& usages, const string& name, bool complete)
+{
+  auto result = usages.emplace(name, complete);
+
+  if (!result.second && complete)
+    result.first->second = true;
+}
+
+// The outermost type is complete when used by value, and template arguments
+// are always considered complete.
+static void add_type_usages(TypeUsages& usages, const ParamDefinition& param, bool by_value_is_complete = true)
+{
+  const string& type = param;
+  bool outer = true;
+  size_t start = 0;
+
+  for (size_t i = 0 ; i <= type.length() ; ++i)
+  {
+    if (i == type.length() || type[i] == '<' || type[i] == '>' || type[i] == ',' || type[i] == ' ' || type[i] == '*' || type[i] == '&')
+    {
+      string name = type.substr(start, i - start);
+
+      if (name.length() > 0 && name != "const")
+      {
+        add_usage(usages, name, outer ? by_value_is_complete && param.is_pointer + param.is_reference == 0 : true);
+        outer = false;
+      }
+      start = i + 1;
+    }
+  }
+}
+
+static void add_invokable_usages(TypeUsages& usages, const InvokableDefinition& invokable)
+{
+  if (invokable.return_type)
+    add_type_usages(usages, *invokable.return_type);
+  for (const ParamDefinition& param : invokable.params)
+    add_type_usages(usages, param);
+}
+
+static unordered_map<string, TypeUsages> collect_usages(const TwiliParser& parser)
+{
+  unordered_map<string, TypeUsages> usages;
+
+  for (const ClassDefinition& klass : parser.get_classes())
+  {
+    TypeUsages& header_usages = usages[klass.from_file];
+
+    for (const string& base : klass.bases)
+      add_usage(header_usages, base, true);
+    for (const MethodDefinition& method : klass.constructors)
+      add_invokable_usages(header_usages, method);
+    for (const MethodDefinition& method : klass.methods)
+      add_invokable_usages(header_usages, method);
+    for (const FieldDefinition& field : klass.fields)
+      add_type_usages(header_usages, field, !field.is_static);
+  }
+  for (const FunctionDefinition& function : parser.get_functions())
+    add_invokable_usages(usages[function.from_file], function);
+  return usages;
+}
+
+static void collect_reachable(const map<string, HeaderDefinition>& headers, const string& path, unordered_set<string>& reached)
+{
+  vector<const string*> pending{&path};
+
+  while (pending.size() > 0)
+  {
+    const string& current = *pending.back();
+
+    pending.pop_back();
+    if (reached.insert(current).second)
+    {
+      auto it = headers.find(current);
+
+      if (it != headers.end())
+      {
+        for (const string& include : it->second.includes)
+          pending.push_back(&include);
+      }
+    }
+  }
+}
+
+static size_t count_dependents(const TwiliParser& parser, const string& path)
+{
+  size_t count = 0;
+
+  for (const auto& entry : parser.get_headers())
+  {
+    unordered_set<string> reached;
+
+    if (entry.first == path || !parser.is_included(entry.first))
+      continue ;
+    collect_reachable(parser.get_headers(), entry.first, reached);
+    count += reached.count(path);
+  }
+  return count;
+}
+
+vector<TwiliIncludeSuggestion> find_forward_declaration_opportunities(const TwiliParser& parser)
+{
+  vector<TwiliIncludeSuggestion> suggestions;
+  const auto& headers = parser.get_headers();
+  unordered_map<string, TypeUsages> usages = collect_usages(parser);
+  unordered_map<string, string> declared_in;
+  unordered_set<string> undeclarable;
+
+  for (const ClassDefinition& klass : parser.get_classes())
+  {
+    declared_in.emplace(klass.full_name, klass.from_file);
+    if (klass.is_template())
+      undeclarable.insert(klass.full_name);
+  }
+  // nested classes can only be declared within their enclosing class
+  for (const ClassDefinition& klass : parser.get_classes())
+  {
+    if (declared_in.count(klass.cpp_context()))
+      undeclarable.insert(klass.full_name);
+  }
+  for (const EnumDefinition& definition : parser.get_enums())
+  {
+    declared_in.emplace(definition.full_name, definition.from_file);
+    undeclarable.insert(definition.full_name);
+  }
+  for (const auto& entry : headers)
+  {
+    const HeaderDefinition& header = entry.second;
+    const TypeUsages& header_usages = usages[header.path];
+    vector<unordered_set<string>> reached(header.includes.size());
+    optional<size_t> dependent_count;
+
+    if (!parser.is_included(header.path) || header_usages.empty())
+      continue ;
+    for (size_t i = 0 ; i < header.includes.size() ; ++i)
+      collect_reachable(headers, header.includes[i], reached[i]);
+    for (size_t i = 0 ; i < header.includes.size() ; ++i)
+    {
+      TwiliIncludeSuggestion suggestion;
+      bool requires_include = false;
+
+      for (const auto& usage : header_usages)
+      {
+        auto declaration = declared_in.find(usage.first);
+
+        if (declaration == declared_in.end() || !reached[i].count(declaration->second))
+          continue ;
+        if (usage.second || undeclarable.count(usage.first))
+          requires_include = true;
+        else
+          suggestion.forward_declarations.push_back(usage.first);
+      }
+      if (requires_include || suggestion.forward_declarations.empty())
+        continue ;
+      for (const string& path : reached[i])
+      {
+        auto file = headers.find(path);
+        bool reached_otherwise = false;
+
+        for (size_t j = 0 ; j < reached.size() && !reached_otherwise ; ++j)
+          reached_otherwise = j != i && reached[j].count(path);
+        if (!reached_otherwise && file != headers.end())
+          suggestion.saved_bytes += file->second.size;
+      }
+      if (!dependent_count)
+        dependent_count = count_dependents(parser, header.path);
+      sort(suggestion.forward_declarations.begin(), suggestion.forward_declarations.end());
+      suggestion.header = header.path;
+      suggestion.include = header.includes[i];
+      suggestion.dependent_count = *dependent_count;
+      suggestions.push_back(suggestion);
+    }
+  }
+  return suggestions;
+}
+
+string TwiliIncludeSuggestion::to_string() const
+{
+  stringstream stream;
+
+  stream << header << ": " << include << " could be replaced by forward declarations of ";
+  for (size_t i = 0 ; i < forward_declarations.size() ; ++i)
+    stream << (i > 0 ? ", " : "") << forward_declarations[i];
+  stream << ", saving " << saved_bytes << " bytes of includes";
+  if (dependent_count > 0)
+    stream << " in it and in " << dependent_count << " dependent headers";
+  return stream.str();
+}
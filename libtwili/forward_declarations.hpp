@@ -0,0 +1,24 @@
+#pragma once
+#include "parser.hpp"
+
+struct TwiliIncludeSuggestion
+{
+  std::string              header;
+  std::string              include;
+  std::vector<std::string> forward_declarations;
+  std::size_t              saved_bytes = 0;     // size of the files only reached through the include
+  std::size_t              dependent_count = 0; // scanned headers which also get these bytes through `header`
+
+  std::string to_string() const;
+};
+
+// Lists the includes of scanned headers which only provide classes used
+// through pointers or references, and could be replaced by forward
+// declarations. Only the declarations are considered: types passed or
+// returned by value, bases, fields held by value and template arguments
+// all require the include, and so do enums, class templates and nested
+// classes, which can't be declared by their name alone. Macros, functions
+// and typedefs used from an include aren't visible from the model, so
+// suggestions are to be reviewed. Requires the include graph, recorded by
+// running the parser with TwiliRunOptions::record_inclusions.
+std::vector<TwiliIncludeSuggestion> find_forward_declaration_opportunities(const TwiliParser&);
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+typedef std::uint64_t TwiliHash;
+
+// 64-bit FNV-1a: unlike std::hash, it is stable across runs and platforms,
+// which makes hashes safe to store and compare between scans.
+const TwiliHash twili_hash_seed = 0xcbf29ce484222325ULL;
+
+inline TwiliHash twili_hash(std::string_view data, TwiliHash hash = twili_hash_seed)
+{
+  for (unsigned char c : data)
+  {
+    hash ^= c;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+inline TwiliHash twili_hash_combine(TwiliHash hash, TwiliHash value)
+{
+  for (int i = 0 ; i < 8 ; ++i)
+  {
+    hash ^= (value >> (i * 8)) & 0xff;
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
@@ -0,0 +1,160 @@
+#include "layout.hpp"
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+static bool is_synchronization_type(const string& type)
+{
+  return type.find("atomic") != string::npos || type.find("mutex") != string::npos || type.find("spinlock") != string::npos;
+}
+
+static long long end_of(const FieldDefinition& field)
+{
+  return field.layout.offset + (field.layout.is_bit_field() ? field.layout.bit_width : field.layout.size * 8);
+}
+
+static long long align_to(long long offset, long long alignment)
+{
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+static vector<const FieldDefinition*> laid_out_fields(const ClassDefinition& klass)
+{
+  vector<const FieldDefinition*> fields;
+
+  for (const FieldDefinition& field : klass.fields)
+  {
+    if (!field.is_static && field.layout.is_known() && field.layout.offset >= 0)
+      fields.push_back(&field);
+  }
+  stable_sort(fields.begin(), fields.end(), [](const FieldDefinition* a, const FieldDefinition* b)
+  {
+    return a->layout.offset < b->layout.offset;
+  });
+  return fields;
+}
+
+static void find_holes(TwiliLayoutReport& report, const vector<const FieldDefinition*>& fields)
+{
+  long long end = fields.front()->layout.offset; // anything before the first field belongs to bases or the vtable pointer
+  string after_field;
+
+  for (const FieldDefinition* field : fields)
+  {
+    long long hole_start = (end + 7) / 8;
+    long long hole_end = field->layout.offset / 8;
+
+    if (hole_end > hole_start)
+      report.holes.push_back({after_field, hole_start, hole_end - hole_start});
+    end = max(end, end_of(*field));
+    after_field = field->name;
+  }
+  if (report.size > (end + 7) / 8)
+    report.holes.push_back({after_field, (end + 7) / 8, report.size - (end + 7) / 8});
+  for (const TwiliPaddingHole& hole : report.holes)
+    report.padding += hole.size;
+}
+
+static void suggest_order(TwiliLayoutReport& report, vector<const FieldDefinition*> fields)
+{
+  long long offset = fields.front()->layout.offset / 8;
+
+  for (const FieldDefinition* field : fields)
+  {
+    if (field->layout.is_bit_field())
+      return ;
+  }
+  stable_sort(fields.begin(), fields.end(), [](const FieldDefinition* a, const FieldDefinition* b)
+  {
+    return a->layout.alignment != b->layout.alignment
+      ? a->layout.alignment > b->layout.alignment
+      : a->layout.size > b->layout.size;
+  });
+  for (const FieldDefinition* field : fields)
+    offset = align_to(offset, field->layout.alignment) + field->layout.size;
+  offset = align_to(offset, report.alignment);
+  if (offset < report.size)
+  {
+    report.suggested_size = offset;
+    for (const FieldDefinition* field : fields)
+      report.suggested_order.push_back(field->name);
+  }
+}
+
+static void find_cache_line_issues(TwiliLayoutReport& report, const vector<const FieldDefinition*>& fields, unsigned int cache_line_size)
+{
+  vector<const FieldDefinition*> synchronized_fields;
+  auto first_line = [cache_line_size](const FieldDefinition* field) { return field->layout.offset / 8 / cache_line_size; };
+  auto last_line = [cache_line_size](const FieldDefinition* field) { return (end_of(*field) - 1) / 8 / cache_line_size; };
+
+  for (const FieldDefinition* field : fields)
+  {
+    if (!field->layout.is_bit_field() && field->layout.size > 0 && field->layout.size <= cache_line_size && first_line(field) != last_line(field))
+      report.straddling_fields.push_back(field->name);
+    if (is_synchronization_type(*field))
+      synchronized_fields.push_back(field);
+  }
+  for (size_t i = 0 ; i < synchronized_fields.size() ; ++i)
+  {
+    for (size_t j = i + 1 ; j < synchronized_fields.size() ; ++j)
+    {
+      if (last_line(synchronized_fields[i]) >= first_line(synchronized_fields[j]))
+        report.false_sharing.emplace_back(synchronized_fields[i]->name, synchronized_fields[j]->name);
+    }
+  }
+}
+
+TwiliLayoutReport analyze_layout(const ClassDefinition& klass, unsigned int cache_line_size)
+{
+  TwiliLayoutReport report;
+  vector<const FieldDefinition*> fields = laid_out_fields(klass);
+
+  report.class_name = klass.full_name;
+  report.size = klass.layout.size;
+  report.alignment = klass.layout.alignment;
+  if (klass.layout.is_known() && fields.size() > 0)
+  {
+    find_holes(report, fields);
+    suggest_order(report, fields);
+    find_cache_line_issues(report, fields, cache_line_size);
+  }
+  return report;
+}
+
+vector<TwiliLayoutReport> analyze_layouts(const TwiliParser& parser, unsigned int cache_line_size)
+{
+  vector<TwiliLayoutReport> reports;
+
+  for (const ClassDefinition& klass : parser.get_classes())
+  {
+    if (klass.layout.is_known())
+      reports.push_back(analyze_layout(klass, cache_line_size));
+  }
+  return reports;
+}
+
+string TwiliLayoutReport::to_string() const
+{
+  stringstream stream;
+
+  stream << class_name << ": " << size << " bytes, aligned on " << alignment << ", " << padding << " bytes of padding";
+  for (const TwiliPaddingHole& hole : holes)
+  {
+    stream << "\n  " << hole.size << " bytes of padding at offset " << hole.offset;
+    if (hole.after_field.length() > 0)
+      stream << " after `" << hole.after_field << '`';
+  }
+  for (const string& field : straddling_fields)
+    stream << "\n  `" << field << "` straddles a cache line boundary";
+  if (suggested_size >= 0)
+  {
+    stream << "\n  ordering fields as ";
+    for (size_t i = 0 ; i < suggested_order.size() ; ++i)
+      stream << (i > 0 ? ", " : "") << suggested_order[i];
+    stream << " would shrink it to " << suggested_size << " bytes";
+  }
+  for (const auto& entry : false_sharing)
+    stream << "\n  `" << entry.first << "` and `" << entry.second << "` share a cache line";
+  return stream.str();
+}
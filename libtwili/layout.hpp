@@ -0,0 +1,33 @@
+#pragma once
+#include "parser.hpp"
+#include <utility>
+
+struct TwiliPaddingHole
+{
+  std::string after_field;
+  long long   offset = 0; // in bytes
+  long long   size = 0;   // in bytes
+};
+
+struct TwiliLayoutReport
+{
+  std::string                   class_name;
+  long long                     size = 0;
+  long long                     alignment = 0;
+  long long                     padding = 0;
+  std::vector<TwiliPaddingHole> holes;
+  std::vector<std::string>      straddling_fields;
+  std::vector<std::string>      suggested_order;
+  long long                     suggested_size = -1;
+  std::vector<std::pair<std::string, std::string>> false_sharing;
+
+  bool        has_issues() const { return padding > 0 || straddling_fields.size() > 0 || false_sharing.size() > 0; }
+  std::string to_string() const;
+};
+
+// Cache lines are counted from the start of the object, as if it were
+// aligned on a cache line. Reordering is only suggested for classes without
+// bit fields, and false sharing is reported for atomic and mutex members
+// sharing a cache line.
+TwiliLayoutReport              analyze_layout(const ClassDefinition&, unsigned int cache_line_size = 64);
+std::vector<TwiliLayoutReport> analyze_layouts(const TwiliParser&, unsigned int cache_line_size = 64);
@@ -2,6 +2,8 @@
 
 using namespace std;
 
+string cxStringToStdString(const CXString& source);
+
 bool MethodDefinition::operator==(const MethodDefinition& other) const
 {
   if (name == other.name && params.size() == other.params.size())
@@ -16,3 +18,85 @@ bool MethodDefinition::operator==(const MethodDefinition& other) const
   return false;
 }
 
+
+optional<bool> MethodDefinition::is_noexcept() const
+{
+  switch (exception_specification)
+  {
+    case CXCursor_ExceptionSpecificationKind_BasicNoexcept:
+    case CXCursor_ExceptionSpecificationKind_DynamicNone:
+    case CXCursor_ExceptionSpecificationKind_NoThrow:
+      return true;
+    case CXCursor_ExceptionSpecificationKind_ComputedNoexcept:
+    case CXCursor_ExceptionSpecificationKind_Unevaluated:
+    case CXCursor_ExceptionSpecificationKind_Uninstantiated:
+    case CXCursor_ExceptionSpecificationKind_Unparsed:
+      return {};
+    default:
+      return false;
+  }
+}
+
+// libclang doesn't evaluate noexcept expressions: the literal ones are
+// solved from the tokens, leaving the others as ComputedNoexcept.
+static CXCursor_ExceptionSpecificationKind evaluate_computed_noexcept(CXCursor cursor)
+{
+  CXTranslationUnit unit = clang_Cursor_getTranslationUnit(cursor);
+  CXToken* tokens = nullptr;
+  unsigned int token_count = 0;
+  auto result = CXCursor_ExceptionSpecificationKind_ComputedNoexcept;
+
+  clang_tokenize(unit, clang_getCursorExtent(cursor), &tokens, &token_count);
+  for (unsigned int i = 0 ; i + 3 < token_count ; ++i)
+  {
+    if (cxStringToStdString(clang_getTokenSpelling(unit, tokens[i])) == "noexcept" &&
+        cxStringToStdString(clang_getTokenSpelling(unit, tokens[i + 1])) == "(")
+    {
+      string operand = cxStringToStdString(clang_getTokenSpelling(unit, tokens[i + 2]));
+
+      if (cxStringToStdString(clang_getTokenSpelling(unit, tokens[i + 3])) == ")")
+      {
+        if (operand == "true")
+          result = CXCursor_ExceptionSpecificationKind_BasicNoexcept;
+        else if (operand == "false")
+          result = CXCursor_ExceptionSpecificationKind_None;
+      }
+      break ;
+    }
+  }
+  clang_disposeTokens(unit, tokens, token_count);
+  return result;
+}
+
+static SpecialMemberKind special_member_kind(CXCursor cursor)
+{
+  if (clang_getCursorKind(cursor) == CXCursor_Constructor)
+  {
+    if (clang_CXXConstructor_isDefaultConstructor(cursor))
+      return DefaultConstructor;
+    if (clang_CXXConstructor_isCopyConstructor(cursor))
+      return CopyConstructor;
+    if (clang_CXXConstructor_isMoveConstructor(cursor))
+      return MoveConstructor;
+  }
+#if CINDEX_VERSION_MINOR >= 63
+  else if (clang_CXXMethod_isCopyAssignmentOperator(cursor))
+    return CopyAssignment;
+  else if (clang_CXXMethod_isMoveAssignmentOperator(cursor))
+    return MoveAssignment;
+#endif
+  return NoSpecialMember;
+}
+
+void MethodDefinition::load_traits(CXCursor cursor)
+{
+  special_member = special_member_kind(cursor);
+  is_defaulted = clang_CXXMethod_isDefaulted(cursor);
+#if CINDEX_VERSION_MINOR >= 63
+  is_deleted = clang_CXXMethod_isDeleted(cursor);
+#endif
+  ref_qualifier = clang_Type_getCXXRefQualifier(clang_getCursorType(cursor));
+  exception_specification = static_cast<CXCursor_ExceptionSpecificationKind>(clang_getCursorExceptionSpecificationType(cursor));
+  if (exception_specification == CXCursor_ExceptionSpecificationKind_ComputedNoexcept)
+    exception_specification = evaluate_computed_noexcept(cursor);
+}
@@ -0,0 +1,336 @@
+#include "multi_config_runner.hpp"
+#include "prefilter.hpp"
+#include "output.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <memory>
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+struct ConfigurationGroup
+{
+  vector<size_t>        members;
+  unordered_set<string> macros; // macros which aren't defined the same way by all members
+  unordered_map<string, bool> mentions; // whether a file mentions any of these macros
+};
+
+static bool is_macro_option(const string& argument)
+{
+  return argument.compare(0, 2, "-D") == 0 || argument.compare(0, 2, "-U") == 0;
+}
+
+// Maps each macro to its option, and gathers the other options in `rest`.
+static map<string, string> macro_options(const vector<string>& arguments, string& rest)
+{
+  map<string, string> macros;
+
+  for (size_t i = 0 ; i < arguments.size() ; ++i)
+  {
+    if (is_macro_option(arguments[i]))
+    {
+      string option = arguments[i];
+
+      if (option.length() == 2 && i + 1 < arguments.size())
+        option += arguments[++i];
+      macros[option.substr(2, option.find('=') - 2)] = option;
+    }
+    else
+      rest += arguments[i] + '\0';
+  }
+  return macros;
+}
+
+static vector<ConfigurationGroup> group_configurations(const vector<TwiliConfiguration>& configurations)
+{
+  vector<ConfigurationGroup> groups;
+  vector<string> keys;
+  vector<map<string, string>> macros;
+
+  for (size_t i = 0 ; i < configurations.size() ; ++i)
+  {
+    string key;
+
+    macros.push_back(macro_options(configurations[i].arguments, key));
+    auto it = find(keys.begin(), keys.end(), key);
+    if (it == keys.end())
+    {
+      keys.push_back(key);
+      groups.emplace_back();
+      it = keys.end() - 1;
+    }
+    groups[it - keys.begin()].members.push_back(i);
+  }
+  for (ConfigurationGroup& group : groups)
+  {
+    for (size_t member : group.members)
+    {
+      for (const auto& entry : macros[member])
+      {
+        for (size_t other : group.members)
+        {
+          auto definition = macros[other].find(entry.first);
+
+          if (definition == macros[other].end() || definition->second != entry.second)
+            group.macros.insert(entry.first);
+        }
+      }
+    }
+  }
+  return groups;
+}
+
+static bool is_identifier_char(char c)
+{
+  return isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static bool mentions_any(const string& path, const unordered_set<string>& macros)
+{
+  ifstream stream(path, ios::binary);
+  string source((istreambuf_iterator<char>(stream)), istreambuf_iterator<char>());
+
+  for (const string& macro : macros)
+  {
+    for (size_t position = source.find(macro) ; position != string::npos ; position = source.find(macro, position + 1))
+    {
+      size_t end = position + macro.length();
+
+      if ((position == 0 || !is_identifier_char(source[position - 1])) && (end == source.length() || !is_identifier_char(source[end])))
+        return true;
+    }
+  }
+  return false;
+}
+
+static bool is_shareable(ConfigurationGroup& group, const TwiliParser& file_parser)
+{
+  for (const auto& entry : file_parser.get_headers())
+  {
+    auto cached = group.mentions.find(entry.first);
+
+    if (cached == group.mentions.end())
+      cached = group.mentions.emplace(entry.first, mentions_any(entry.first, group.macros)).first;
+    if (cached->second)
+      return false;
+  }
+  return file_parser.get_headers().size() > 0;
+}
+
+static unique_ptr<TwiliParser> make_file_parser(const TwiliParser& parser)
+{
+  auto file_parser = make_unique<TwiliParser>();
+
+  for (const string& directory : parser.get_directories())
+    file_parser->add_directory(directory);
+  file_parser->set_filter(parser.get_filter());
+  file_parser->set_handlers(parser.get_handlers());
+  file_parser->set_deferred_resolution(parser.has_deferred_resolution());
+  file_parser->set_detail_level(parser.get_detail_level());
+  file_parser->set_verbose(parser.is_verbose());
+  return file_parser;
+}
+
+static TwiliRunReport parse_file(TwiliParser& file_parser, const filesystem::path& file, const TwiliConfiguration& configuration, const TwiliRunOptions& options)
+{
+  vector<const char*> argv;
+
+  for (const string& argument : configuration.arguments)
+    argv.push_back(argument.c_str());
+  return run_parser(file_parser, {file}, options, argv.size(), argv.data());
+}
+
+template<typename LIST>
+static void tag_members(LIST& members, const LIST& additions, ConfigurationMask bit)
+{
+  for (const auto& addition : additions)
+  {
+    auto it = find(members.begin(), members.end(), addition);
+
+    if (it == members.end())
+    {
+      members.push_back(addition);
+      members.back().configurations = bit;
+    }
+    else
+      it->configurations |= bit;
+  }
+}
+
+static void tag_class(vector<ClassDefinition>& classes, unordered_map<string, size_t>& indexes, const ClassDefinition& klass, ConfigurationMask bit)
+{
+  auto it = indexes.find(klass.full_name);
+
+  if (it == indexes.end())
+  {
+    ClassDefinition& added = classes.emplace_back(klass);
+
+    indexes.emplace(klass.full_name, classes.size() - 1);
+    added.configurations = bit;
+    for (auto* list : {&added.constructors, &added.methods})
+    {
+      for (auto& method : *list)
+        method.configurations = bit;
+    }
+    for (auto& field : added.fields)
+      field.configurations = bit;
+  }
+  else
+  {
+    ClassDefinition& existing = classes[it->second];
+
+    existing.configurations |= bit;
+    tag_members(existing.constructors, klass.constructors, bit);
+    tag_members(existing.methods, klass.methods, bit);
+    tag_members(existing.fields, klass.fields, bit);
+  }
+}
+
+static void merge_configurations(TwiliParser& parser, const vector<unique_ptr<TwiliParser>>& models)
+{
+  vector<ClassDefinition> classes;
+  unordered_map<string, size_t> class_indexes;
+  vector<EnumDefinition> enums;
+  vector<FunctionDefinition> functions;
+
+  for (size_t i = 0 ; i < models.size() ; ++i)
+  {
+    const TwiliParser& model = *models[i];
+    ConfigurationMask bit = ConfigurationMask(1) << i;
+
+    for (const auto& ns : model.get_namespaces())
+      parser.add_namespace(ns);
+    for (const auto& type : model.get_types())
+      parser.add_type(type);
+    for (const auto& entry : model.get_headers())
+      parser.add_header(entry.second);
+    for (const auto& klass : model.get_classes())
+      tag_class(classes, class_indexes, klass, bit);
+    for (const auto& definition : model.get_enums())
+    {
+      auto it = find_if(enums.begin(), enums.end(), [&definition](const EnumDefinition& candidate) { return candidate.full_name == definition.full_name; });
+
+      if (it == enums.end())
+        (enums.emplace_back(definition)).configurations = bit;
+      else
+        it->configurations |= bit;
+    }
+    for (const auto& function : model.get_functions())
+    {
+      auto it = find_if(functions.begin(), functions.end(), [&function](const FunctionDefinition& candidate)
+      {
+        return candidate.full_name == function.full_name && candidate.params == function.params;
+      });
+
+      if (it == functions.end())
+        (functions.emplace_back(function)).configurations = bit;
+      else
+        it->configurations |= bit;
+    }
+  }
+  for (const auto& klass : classes)
+    parser.add_class(klass);
+  for (const auto& definition : enums)
+    parser.add_enum(definition);
+  for (const auto& function : functions)
+    parser.add_function(function);
+}
+
+TwiliMultiRunReport run_multi_config_parser(TwiliParser& parser, const vector<filesystem::path>& files, const vector<TwiliConfiguration>& configurations, const TwiliRunOptions& options)
+{
+  TwiliMultiRunReport report;
+  TwiliRunOptions file_options = options;
+  vector<ConfigurationGroup> groups = group_configurations(configurations);
+  vector<unique_ptr<TwiliParser>> models;
+  TwiliScanMonitor* monitor = parser.get_monitor();
+  bool failed = false;
+
+  if (configurations.empty())
+    return report;
+  if (configurations.size() > 64)
+    throw invalid_argument("run_multi_config_parser: no more than 64 configurations are supported");
+  file_options.resolve_types = false;
+  file_options.prefilter = false;
+  file_options.record_inclusions = options.record_inclusions || !options.depfile_path.empty();
+  file_options.output_path.clear();
+  file_options.depfile_path.clear();
+  report.reports.resize(configurations.size());
+  for (size_t i = 0 ; i < configurations.size() ; ++i)
+    models.push_back(make_file_parser(parser));
+  if (monitor)
+    monitor->files_total.store(files.size(), memory_order_relaxed);
+  for (const auto& file : files)
+  {
+    if (failed || (monitor && monitor->cancelled.load(memory_order_relaxed)))
+      break ;
+    if (options.prefilter && !may_declare_symbols(file))
+    {
+      for (TwiliRunReport& config_report : report.reports)
+      {
+        TwiliFileReport& file_report = config_report.files.emplace_back();
+
+        file_report.path = file.string();
+        file_report.skipped = true;
+      }
+      if (monitor)
+        monitor->files_done.fetch_add(1, memory_order_relaxed);
+      continue ;
+    }
+    for (ConfigurationGroup& group : groups)
+    {
+      for (size_t member : group.members)
+      {
+        auto file_parser = make_file_parser(parser);
+        TwiliRunOptions member_options = file_options;
+        bool is_lead = member == group.members.front() && group.members.size() > 1;
+        bool shared;
+
+        member_options.record_inclusions = file_options.record_inclusions || is_lead;
+        TwiliRunReport file_report = parse_file(*file_parser, file, configurations[member], member_options);
+
+        report.units_parsed++;
+        failed = failed || (!options.keep_going && !file_report.success());
+        shared = is_lead && file_report.success() && is_shareable(group, *file_parser);
+        for (size_t target : group.members)
+        {
+          if (target == member || shared)
+          {
+            models[target]->merge(*file_parser);
+            report.reports[target].files.insert(report.reports[target].files.end(), file_report.files.begin(), file_report.files.end());
+            report.units_shared += target != member ? 1 : 0;
+          }
+        }
+        if (shared)
+          break ;
+      }
+    }
+    if (monitor)
+      monitor->files_done.fetch_add(1, memory_order_relaxed);
+  }
+  for (size_t i = 0 ; i < configurations.size() ; ++i)
+    report.reports[i].cancelled = monitor && monitor->cancelled.load(memory_order_relaxed);
+  merge_configurations(parser, models);
+  if (!report.reports.front().cancelled)
+  {
+    TwiliRunReport combined;
+
+    if (options.resolve_types)
+      report.unresolved_types = parser.resolve_types();
+    for (const TwiliRunReport& config_report : report.reports)
+      combined.files.insert(combined.files.end(), config_report.files.begin(), config_report.files.end());
+    write_run_outputs(parser, combined, options);
+  }
+  return report;
+}
+
+TwiliMultiRunReport probe_and_run_multi_config_parser(TwiliParser& parser, const vector<TwiliConfiguration>& configurations, const TwiliRunOptions& options)
+{
+  return run_multi_config_parser(parser, probe_files(parser), configurations, options);
+}
+
+bool TwiliMultiRunReport::success() const
+{
+  return all_of(reports.begin(), reports.end(), [](const TwiliRunReport& report) { return report.success(); });
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "runner.hpp"
+
+struct TwiliConfiguration
+{
+  std::string              name;
+  std::vector<std::string> arguments;
+};
+
+struct TwiliMultiRunReport
+{
+  std::vector<TwiliRunReport> reports; // one for each configuration
+  std::vector<std::string>    unresolved_types;
+  std::size_t                 units_parsed = 0;
+  std::size_t                 units_shared = 0; // results reused for other configurations
+
+  bool success() const;
+};
+
+// Scans the files once for each configuration, and merges the results in
+// `parser`, tagging classes, methods, fields, enums and functions with the
+// configurations which declare them (bit `i` stands for `configurations[i]`,
+// and there can be at most 64 of them).
+// Files are discovered and pre-filtered once. Configurations which only
+// differ by -D and -U options share their translation units when neither
+// the file nor its includes mention the differing macros.
+TwiliMultiRunReport run_multi_config_parser(TwiliParser&, const std::vector<std::filesystem::path>&, const std::vector<TwiliConfiguration>&, const TwiliRunOptions&);
+TwiliMultiRunReport probe_and_run_multi_config_parser(TwiliParser&, const std::vector<TwiliConfiguration>&, const TwiliRunOptions&);
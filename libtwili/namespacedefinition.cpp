@@ -1,23 +1,38 @@
 #include "definitions.hpp"
-#include <crails/utils/split.hpp>
-#include <sstream>
+#include <algorithm>
 
 using namespace std;
 
-string NamespaceDefinition::cpp_context() const
+string scope_of(const string& full_name)
+{
+  size_t separator = full_name.rfind("::");
+
+  return separator != string::npos && separator > 0 ? full_name.substr(0, separator) : string("::");
+}
+
+vector<string> type_names_in(const string& type)
 {
-  auto parts = Crails::split(full_name, ':');
-  auto last = parts.begin();
-  stringstream stream;
+  vector<string> names;
+  size_t start = 0;
 
-  if (parts.size() > 1)
+  for (size_t i = 0 ; i <= type.length() ; ++i)
   {
-    advance(last, parts.size() - 1);
-    parts.erase(last);
-    for (const auto& part : parts)
-      stream << "::" << part;
+    if (i == type.length() || type[i] == '<' || type[i] == '>' || type[i] == ',' || type[i] == ' ' || type[i] == '*' || type[i] == '&' || type[i] == '(' || type[i] == ')')
+    {
+      if (i > start)
+      {
+        string name = type.substr(start, i - start);
+
+        if (name != "const" && find(names.begin(), names.end(), name) == names.end())
+          names.push_back(name);
+      }
+      start = i + 1;
+    }
   }
-  else
-    stream << "::";
-  return stream.str();
+  return names;
+}
+
+string NamespaceDefinition::cpp_context() const
+{
+  return scope_of(full_name);
 }
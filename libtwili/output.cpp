@@ -0,0 +1,122 @@
+#include "output.hpp"
+#include "serializer.hpp"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static bool has_contents(const filesystem::path& path, string_view contents)
+{
+  error_code error;
+  ifstream stream(path, ios::binary);
+  size_t offset = 0;
+  char buffer[65536];
+
+  if (!stream.is_open() || filesystem::file_size(path, error) != contents.size() || error)
+    return false;
+  while (stream.read(buffer, sizeof(buffer)) || stream.gcount() > 0)
+  {
+    size_t length = stream.gcount();
+
+    if (offset + length > contents.size() || memcmp(buffer, contents.data() + offset, length) != 0)
+      return false;
+    offset += length;
+  }
+  return offset == contents.size();
+}
+
+bool write_if_changed(const filesystem::path& path, string_view contents)
+{
+  filesystem::path temporary_path = path;
+  error_code error;
+
+  if (has_contents(path, contents))
+    return false;
+  if (path.has_parent_path())
+    filesystem::create_directories(path.parent_path());
+  temporary_path += ".tmp";
+  {
+    ofstream stream(temporary_path, ios::binary | ios::trunc);
+
+    stream.write(contents.data(), contents.size());
+    stream.close();
+    if (!stream)
+    {
+      filesystem::remove(temporary_path, error);
+      throw runtime_error("write_if_changed: could not write " + temporary_path.string());
+    }
+  }
+  filesystem::rename(temporary_path, path, error);
+  if (error)
+  {
+    filesystem::remove(temporary_path, error);
+    throw runtime_error("write_if_changed: could not replace " + path.string());
+  }
+  return true;
+}
+
+// Make only reads backslashes as escapes when they precede a space, in
+// which case each of them gets doubled. So does a trailing run, which the
+// separator following the path would otherwise be taken for.
+static string escape_depfile_path(const string& path)
+{
+  string result;
+
+  for (size_t i = 0 ; i < path.length() ; ++i)
+  {
+    char c = path[i];
+
+    if (c == '\\')
+    {
+      size_t end = path.find_first_not_of('\\', i);
+      size_t count = (end == string::npos ? path.length() : end) - i;
+
+      result.append(end == string::npos || path[end] == ' ' ? count * 2 : count, '\\');
+      i += count - 1;
+      continue ;
+    }
+    if (c == ' ' || c == '#')
+      result += '\\';
+    else if (c == '$')
+      result += '$';
+    result += c;
+  }
+  return result;
+}
+
+string render_depfile(const string& target, const vector<string>& prerequisites)
+{
+  string result = escape_depfile_path(target) + ':';
+
+  for (const string& prerequisite : prerequisites)
+    result += " \\\n  " + escape_depfile_path(prerequisite);
+  return result + '\n';
+}
+
+vector<string> model_dependencies(const TwiliParser& parser, const TwiliRunReport& report)
+{
+  vector<string> dependencies;
+
+  for (const TwiliFileReport& file : report.files)
+    dependencies.push_back(file.path);
+  for (const auto& entry : parser.get_headers())
+    dependencies.push_back(entry.first);
+  sort(dependencies.begin(), dependencies.end());
+  dependencies.erase(unique(dependencies.begin(), dependencies.end()), dependencies.end());
+  return dependencies;
+}
+
+void write_run_outputs(const TwiliParser& parser, const TwiliRunReport& report, const TwiliRunOptions& options)
+{
+  if (!report.success())
+    return ;
+  if (!options.output_path.empty())
+    write_if_changed(options.output_path, serialize_model(parser));
+  if (!options.depfile_path.empty())
+  {
+    filesystem::path target = options.output_path.empty() ? options.depfile_path : options.output_path;
+
+    write_if_changed(options.depfile_path, render_depfile(target.string(), model_dependencies(parser, report)));
+  }
+}
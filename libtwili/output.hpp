@@ -0,0 +1,17 @@
+#pragma once
+#include "runner.hpp"
+
+// Leaves the file untouched, along with its modification time, when it
+// already holds `contents`. Otherwise writes a temporary file next to it,
+// then renames it over the file. Returns whether the file was written.
+bool write_if_changed(const std::filesystem::path&, std::string_view contents);
+
+// Make-style dependency file, which build2 also reads.
+std::string render_depfile(const std::string& target, const std::vector<std::string>& prerequisites);
+
+// Scanned files and every file their translation units included.
+std::vector<std::string> model_dependencies(const TwiliParser&, const TwiliRunReport&);
+
+// Writes the serialized model and the depfile requested by the options,
+// unless the run failed: the outputs of the last successful run are kept.
+void write_run_outputs(const TwiliParser&, const TwiliRunReport&, const TwiliRunOptions&);
@@ -0,0 +1,110 @@
+#include "parallel_runner.hpp"
+#include "output.hpp"
+#include <thread>
+#include <optional>
+#include <iostream>
+
+using namespace std;
+
+static unique_ptr<TwiliParser> make_thread_parser(const TwiliParser& parser, TwiliSharedRegistry& registry)
+{
+  auto thread_parser = make_unique<TwiliParser>();
+
+  for (const string& directory : parser.get_directories())
+    thread_parser->add_directory(directory);
+  thread_parser->set_filter(parser.get_filter());
+  thread_parser->set_handlers(parser.get_handlers());
+  thread_parser->set_deferred_resolution(true);
+  thread_parser->set_detail_level(parser.get_detail_level());
+  thread_parser->set_verbose(false);
+  thread_parser->set_shared_registry(&registry);
+  return thread_parser;
+}
+
+// Whatever `parser` already holds counts as found, so that threads don't
+// visit its class definitions again.
+static void seed_registry(TwiliSharedRegistry& registry, const TwiliParser& parser)
+{
+  for (const auto& type : parser.get_types())
+    registry.add_type(type);
+  for (const auto& klass : parser.get_classes())
+  {
+    if (klass.has_definition)
+      registry.classes.insert(klass.full_name, &parser);
+  }
+}
+
+TwiliRunReport run_parallel_parser(TwiliParser& parser, const vector<filesystem::path>& files, const TwiliParallelOptions& options, int argc, const char** argv)
+{
+  TwiliRunReport report;
+  TwiliSharedRegistry registry(options.registry_buckets);
+  TwiliRunOptions file_options = options.run_options;
+  size_t thread_count = options.thread_count > 0 ? options.thread_count : max(1u, thread::hardware_concurrency());
+  vector<unique_ptr<TwiliParser>> parsers;
+  vector<optional<TwiliFileReport>> results(files.size());
+  vector<thread> workers;
+  atomic<size_t> next_file{0};
+  atomic<bool> failed{false};
+  TwiliScanMonitor* monitor = parser.get_monitor();
+
+  file_options.resolve_types = false;
+  file_options.verbose = false;
+  file_options.record_inclusions = options.run_options.record_inclusions || !options.run_options.depfile_path.empty();
+  file_options.output_path.clear();
+  file_options.depfile_path.clear();
+  thread_count = min(thread_count, max<size_t>(1, files.size()));
+  if (monitor)
+    monitor->files_total.store(files.size(), memory_order_relaxed);
+  seed_registry(registry, parser);
+  for (size_t i = 0 ; i < thread_count ; ++i)
+    parsers.push_back(make_thread_parser(parser, registry));
+  for (size_t i = 0 ; i < thread_count ; ++i)
+  {
+    workers.emplace_back([&, i]()
+    {
+      for (size_t index = next_file++ ; index < files.size() ; index = next_file++)
+      {
+        if ((monitor && monitor->cancelled.load(memory_order_relaxed)) || (!file_options.keep_going && failed.load(memory_order_relaxed)))
+          break ;
+        TwiliRunReport file_report = run_parser(*parsers[i], {files[index]}, file_options, argc, argv);
+
+        if (file_report.files.size() > 0)
+        {
+          results[index] = std::move(file_report.files.front());
+          if (results[index]->has_failed())
+            failed.store(true, memory_order_relaxed);
+        }
+        if (monitor)
+          monitor->files_done.fetch_add(1, memory_order_relaxed);
+      }
+    });
+  }
+  for (auto& worker : workers)
+    worker.join();
+  for (auto& result : results)
+  {
+    if (result)
+      report.files.push_back(std::move(*result));
+  }
+  report.cancelled = monitor && monitor->cancelled.load(memory_order_relaxed);
+  for (const auto& thread_parser : parsers)
+    parser.merge(*thread_parser);
+  if (options.run_options.resolve_types && !report.cancelled)
+  {
+    TwiliSharedRegistry* previous_registry = parser.get_shared_registry();
+
+    parser.set_shared_registry(&registry);
+    report.unresolved_types = parser.resolve_types();
+    parser.set_shared_registry(previous_registry);
+  }
+  if (options.run_options.verbose && (!report.success() || report.unresolved_types.size() > 0))
+    cerr << '\r' << report.summary() << endl;
+  if (!report.cancelled)
+    write_run_outputs(parser, report, options.run_options);
+  return report;
+}
+
+TwiliRunReport probe_and_run_parallel_parser(TwiliParser& parser, const TwiliParallelOptions& options, int argc, const char** argv)
+{
+  return run_parallel_parser(parser, probe_files(parser), options, argc, argv);
+}
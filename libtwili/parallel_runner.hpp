@@ -0,0 +1,21 @@
+#pragma once
+#include "runner.hpp"
+#include "registry.hpp"
+
+struct TwiliParallelOptions
+{
+  unsigned int    thread_count = 0; // defaults to the hardware concurrency
+  std::size_t     registry_buckets = 65536;
+  TwiliRunOptions run_options;
+};
+
+// Visits the files on several threads, each with its own TwiliParser, all
+// sharing one TwiliSharedRegistry: a class definition is only visited by the
+// first thread to reach it, base classes and types are looked up across all
+// threads, and the results are merged into `parser` once every file is done.
+// Type resolution always runs against the complete registry, so what gets
+// found and how it resolves does not depend on how files were spread across
+// threads; only the order of the classes may.
+// Cancelling through the parser's monitor stops the threads at the next file.
+TwiliRunReport run_parallel_parser(TwiliParser&, const std::vector<std::filesystem::path>&, const TwiliParallelOptions&, int argc = 0, const char** argv = nullptr);
+TwiliRunReport probe_and_run_parallel_parser(TwiliParser&, const TwiliParallelOptions&, int argc = 0, const char** argv = nullptr);
@@ -1,67 +1,94 @@
 #include "definitions.hpp"
-#include <map>
-#include <crails/utils/join.hpp>
+#include <stdexcept>
 
 using namespace std;
 
-const map<CXTypeKind, string> type_to_name{
-  {CXType_Bool,       "bool"},
-  {CXType_Char_U,     "char"},
-  {CXType_UChar,      "unsigned char"},
-  {CXType_UShort,     "unsigned short"},
-  {CXType_UInt,       "unsigned int"},
-  {CXType_ULong,      "unsigned long"},
-  {CXType_ULongLong,  "unsigned long long"},
-  {CXType_Short,      "short"},
-  {CXType_Int,        "int"},
-  {CXType_Long,       "long"},
-  {CXType_LongLong,   "long long"},
-  {CXType_Float,      "float"},
-  {CXType_Double,     "double"},
-  {CXType_LongDouble, "long double"}
-};
-
 string cxStringToStdString(const CXString& source);
 
-ParamDefinition::ParamDefinition(CXCursor cursor, const std::vector<TypeDefinition>& known_types)
+ParamDefinition::ParamDefinition(CXCursor cursor, const std::vector<TypeDefinition>& known_types, bool deferred)
 {
   name = cxStringToStdString(clang_getCursorSpelling(cursor));
-  initialize_type(clang_getCursorType(cursor), known_types);
+  initialize_type(clang_getCursorType(cursor), known_types, deferred);
 }
 
-ParamDefinition::ParamDefinition(CXType type, const std::vector<TypeDefinition>& known_types)
+ParamDefinition::ParamDefinition(CXType type, const std::vector<TypeDefinition>& known_types, bool deferred)
 {
-  initialize_type(type, known_types);
+  initialize_type(type, known_types, deferred);
 }
 
-void ParamDefinition::initialize_type(CXType type, const std::vector<TypeDefinition>& known_types)
+// When deferred, the parameter keeps its type as written until resolve_type
+// gets called against the complete type registry.
+void ParamDefinition::initialize_type(CXType type, const std::vector<TypeDefinition>& known_types, bool deferred)
 {
-  auto it = type_to_name.find(type.kind);
+  TypeReference reference(type);
 
   if (type.kind == CXType_Invalid)
     throw std::logic_error("Called ParamDefinition::initialize_type with invalid type");
-  if (it != type_to_name.end())
-    append(it->second);
+  if (reference.is_builtin() || reference.is_spelled())
+  {
+    append(reference.name);
+    is_const = reference.is_const;
+    is_reference += reference.reference_count();
+    is_pointer += reference.pointer_count();
+  }
   else
   {
-    TypeDefinition param_type;
-    optional<TypeDefinition> parent_type;
+    TypeDefinition& param_type = unresolved_type.emplace();
 
     param_type.load_from(type, known_types);
     type_alias = param_type.name;
     is_const = param_type.is_const;
     is_reference += param_type.is_reference;
     is_pointer += param_type.is_pointer;
-    parent_type = param_type.find_parent_type(known_types);
+    assign(param_type.scoped_name());
+    if (!deferred)
+      resolve_type(known_types);
+  }
+}
+
+void ParamDefinition::resolve_type(const std::vector<TypeDefinition>& known_types)
+{
+  if (unresolved_type)
+  {
+    optional<TypeDefinition> parent_type = unresolved_type->find_parent_type(known_types);
+    size_t template_at = unresolved_type->name.find('<');
+    string template_arguments;
+
+    if (!parent_type && template_at != string::npos)
+    {
+      template_arguments = unresolved_type->name.substr(template_at);
+      unresolved_type->name = unresolved_type->name.substr(0, template_at);
+      parent_type = unresolved_type->find_parent_type(known_types);
+    }
     if (parent_type)
     {
-      append(parent_type->type_full_name);
+      is_symbolic = false;
+      assign(parent_type->type_full_name + template_arguments);
       is_const = is_const || parent_type->is_const;
       is_reference += parent_type->is_reference;
       is_pointer += parent_type->is_pointer;
     }
-    else
-      append(Crails::join(param_type.scopes, "::") + "::" + param_type.name);
+    unresolved_type.reset();
+  }
+}
+
+void ParamDefinition::load_spelled_type(const std::string& spelled_type, const std::vector<std::string>& declaration_scope)
+{
+  TypeDefinition param_type;
+
+  param_type.load_from(spelled_type, {});
+  type_alias = param_type.name;
+  is_const = param_type.is_const;
+  is_reference += param_type.is_reference;
+  is_pointer += param_type.is_pointer;
+  if (param_type.scopes.size() == 0 && is_builtin_type_name(param_type.name))
+    assign(param_type.name);
+  else
+  {
+    assign(param_type.scoped_name());
+    param_type.declaration_scope = declaration_scope;
+    unresolved_type = param_type;
+    is_symbolic = true;
   }
 }
 
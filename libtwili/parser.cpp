@@ -1,7 +1,9 @@
 #include "parser.hpp"
+#include "registry.hpp"
 #include <iostream>
 #include <functional>
 #include <sstream>
+#include <thread>
 #include <crails/utils/split.hpp>
 #include <crails/utils/join.hpp>
 #include <crails/utils/semantics.hpp>
@@ -41,6 +43,7 @@ static bool find_parsing_errors(CXTranslationUnit translationUnit)
     if (tmp.find("error:") != string::npos)
       foundError = true;
     cerr << tmp << endl;
+    clang_disposeDiagnostic(diagnotic);
   }
   return foundError;
 }
@@ -50,18 +53,14 @@ static void twilog(const std::stringstream& stream)
   cout << '\r' << stream.str() << endl;
 }
 
-#define TWILOG(body) twilog(std::stringstream() << body)
+#define TWILOG(body) do { if (verbose) twilog(std::stringstream() << body); } while (0)
 
-TwiliParser* parser = nullptr;
-
-TwiliParser::TwiliParser()
+TwiliParser::TwiliParser() : handlers(default_handlers)
 {
-  parser = this;
 }
 
 TwiliParser::~TwiliParser()
 {
-  parser = nullptr;
 }
 
 void TwiliParser::print_state()
@@ -88,7 +87,16 @@ void TwiliParser::add_directory(const string& path)
 
 void TwiliParser::add_directory(const filesystem::path& path)
 {
-  directories.push_back(filesystem::canonical(path).string());
+  directories.push_back(filesystem::weakly_canonical(path).string());
+}
+
+static string path_of(CXFile file)
+{
+  string path = cxStringToStdString(clang_File_tryGetRealPathName(file));
+
+  if (path.length() == 0) // in-memory files have no real path
+    path = cxStringToStdString(clang_getFileName(file));
+  return path;
 }
 
 filesystem::path TwiliParser::get_current_path() const
@@ -97,7 +105,7 @@ filesystem::path TwiliParser::get_current_path() const
   CXFile cursorFile;
 
   clang_getExpansionLocation(location, &cursorFile, nullptr, nullptr, nullptr);
-  return filesystem::path(cxStringToStdString(clang_File_tryGetRealPathName(cursorFile)));
+  return filesystem::path(path_of(cursorFile));
 }
 
 bool TwiliParser::is_included(const std::filesystem::path& path) const
@@ -127,6 +135,177 @@ bool TwiliParser::has_class(const std::string& class_name) const
   return std::find(classes.begin(), classes.end(), class_name) != classes.end();
 }
 
+static TypeDefinition type_definition_for(const ClassDefinition& klass)
+{
+  TypeDefinition type_definition;
+
+  type_definition.name = klass.name;
+  type_definition.scopes = Crails::split<std::string, std::vector<std::string>>(klass.cpp_context(), ':');
+  type_definition.type_full_name = klass.full_name;
+  type_definition.kind = klass.type == "struct" ? StructKind : ClassKind;
+  return type_definition;
+}
+
+void TwiliParser::add_namespace(const NamespaceDefinition& definition)
+{
+  if (std::find(namespaces.begin(), namespaces.end(), definition.full_name) == namespaces.end())
+  {
+    NamespaceContext ns_context;
+
+    ns_context.ns = definition;
+    namespaces.push_back(ns_context);
+  }
+}
+
+void TwiliParser::add_class(const ClassDefinition& definition)
+{
+  ClassContext* existing_class = find_class_by_name(definition.full_name);
+
+  if (!existing_class)
+  {
+    ClassContext class_context;
+
+    class_context.klass = definition;
+    class_context.current_access = CX_CXXPublic;
+    add_type(type_definition_for(definition));
+    classes.push_back(class_context);
+  }
+  else if (definition.has_definition && !existing_class->klass.has_definition)
+    existing_class->klass = definition;
+}
+
+void TwiliParser::add_enum(const EnumDefinition& definition)
+{
+  auto existing_enum = std::find(enums.begin(), enums.end(), definition.full_name);
+
+  if (existing_enum == enums.end())
+  {
+    EnumContext enum_context;
+
+    enum_context.en = definition;
+    enums.push_back(enum_context);
+  }
+  else if (existing_enum->en.flags.size() == 0)
+    existing_enum->en.flags = definition.flags;
+}
+
+void TwiliParser::add_function(const FunctionDefinition& definition)
+{
+  auto existing_function = std::find_if(functions.begin(), functions.end(), [&definition](const FunctionDefinition& candidate)
+  {
+    return candidate.full_name == definition.full_name && candidate.params == definition.params;
+  });
+
+  if (existing_function == functions.end())
+    functions.push_back(definition);
+}
+
+void TwiliParser::add_header(const HeaderDefinition& definition)
+{
+  HeaderDefinition& header = headers[definition.path];
+
+  header.path = definition.path;
+  header.size = max(header.size, definition.size);
+  for (const string& include : definition.includes)
+  {
+    if (std::find(header.includes.begin(), header.includes.end(), include) == header.includes.end())
+      header.includes.push_back(include);
+  }
+}
+
+void TwiliParser::merge(const TwiliParser& other)
+{
+  for (const auto& entry : other.namespaces)
+    add_namespace(entry.ns);
+  for (const auto& type : other.types)
+    add_type(type);
+  for (const auto& entry : other.classes)
+    add_class(entry.klass);
+  for (const auto& entry : other.enums)
+    add_enum(entry.en);
+  for (const auto& function : other.functions)
+    add_function(function);
+  for (const auto& entry : other.headers)
+    add_header(entry.second);
+}
+
+unsigned int TwiliParser::translation_unit_flags() const
+{
+  switch (detail_level)
+  {
+  case InventoryLevel:
+    return CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete;
+  case SignaturesLevel:
+    return CXTranslationUnit_SkipFunctionBodies;
+  case FullLevel:
+    break ;
+  }
+  return CXTranslationUnit_None;
+}
+
+static void collect_unresolved(InvokableDefinition& invokable, vector<ParamDefinition*>& pending)
+{
+  if (invokable.return_type && !invokable.return_type->is_resolved())
+    pending.push_back(&(*invokable.return_type));
+  for (auto& param : invokable.params)
+  {
+    if (!param.is_resolved())
+      pending.push_back(&param);
+  }
+}
+
+// The type registry does not change during this pass, so each parameter can
+// be resolved independently: they get split in contiguous slices, one for
+// each thread. Returns the spelled types which matched no known type.
+// With a shared registry, the types found by every parser sharing it count.
+vector<string> TwiliParser::resolve_types(unsigned int thread_count)
+{
+  vector<ParamDefinition*> pending;
+  vector<thread> workers;
+  vector<string> unresolved;
+  vector<TypeDefinition> shared_types;
+  const vector<TypeDefinition>& known_types = shared_registry ? (shared_types = shared_registry->get_types()) : types;
+  size_t slice_size;
+
+  for (auto& entry : classes)
+  {
+    for (auto& constructor : entry.klass.constructors)
+      collect_unresolved(constructor, pending);
+    for (auto& method : entry.klass.methods)
+      collect_unresolved(method, pending);
+    for (auto& field : entry.klass.fields)
+    {
+      if (!field.is_resolved())
+        pending.push_back(&field);
+    }
+  }
+  for (auto& function : functions)
+    collect_unresolved(function, pending);
+  if (thread_count == 0)
+    thread_count = max(1u, thread::hardware_concurrency());
+  slice_size = (pending.size() + thread_count - 1) / thread_count;
+  for (size_t begin = 0 ; begin < pending.size() ; begin += slice_size)
+  {
+    size_t end = min(begin + slice_size, pending.size());
+
+    workers.emplace_back([&known_types, &pending, begin, end]()
+    {
+      for (size_t i = begin ; i < end ; ++i)
+        pending[i]->resolve_type(known_types);
+    });
+  }
+  for (auto& worker : workers)
+    worker.join();
+  for (const ParamDefinition* param : pending)
+  {
+    if (param->is_symbolic)
+      unresolved.push_back(*param);
+  }
+  sort(unresolved.begin(), unresolved.end());
+  unresolved.erase(unique(unresolved.begin(), unresolved.end()), unresolved.end());
+  return unresolved;
+}
+
 std::vector<ClassDefinition> TwiliParser::get_classes() const
 {
   std::vector<ClassDefinition> result;
@@ -151,23 +330,36 @@ std::vector<EnumDefinition> TwiliParser::get_enums() const
   return result;
 }
 
+bool TwiliParser::accepts_member(const ClassContext& class_context) const
+{
+  return filter.accepts_access(class_context.current_access);
+}
+
+void TwiliParser::TranslationUnitScope::clear()
+{
+  classes.clear();
+  namespaces.clear();
+  enums.clear();
+  record_traits.clear();
+}
+
 optional<string> TwiliParser::fullname_for(CXCursor cursor) const
 {
-  auto ns_it = std::find(namespaces.begin(), namespaces.end(), cursor);
-  auto class_it = std::find(classes.begin(), classes.end(), cursor);
+  auto ns_it = scope.namespaces.find(cursor);
+  auto class_it = scope.classes.find(cursor);
 
-  if (ns_it != namespaces.end())
-    return ns_it->ns.full_name;
-  else if (class_it != classes.end())
-    return class_it->klass.full_name;
+  if (ns_it != scope.namespaces.end())
+    return ns_it->second == TranslationUnitScope::global_scope ? string() : namespaces[ns_it->second].ns.full_name;
+  else if (class_it != scope.classes.end())
+    return classes[class_it->second].klass.full_name;
   return optional<string>();
 }
 
 TwiliParser::ClassContext* TwiliParser::find_class_for(CXCursor cursor)
 {
-  auto it = std::find(classes.begin(), classes.end(), cursor);
+  auto it = scope.classes.find(cursor);
 
-  return it != classes.end() ? &(*it) : nullptr;
+  return it != scope.classes.end() ? &classes[it->second] : nullptr;
 }
 
 TwiliParser::ClassContext* TwiliParser::find_class_by_name(const std::string& full_name)
@@ -177,11 +369,16 @@ TwiliParser::ClassContext* TwiliParser::find_class_by_name(const std::string& fu
   return it != classes.end() ? &(*it) : nullptr;
 }
 
-TwiliParser::ClassContext* TwiliParser::find_class_like(const std::string& symbol_name, const std::string& cpp_context)
+bool TwiliParser::knows_class(const std::string& full_name) const
+{
+  return has_class(full_name) || (shared_registry && shared_registry->classes.find(full_name));
+}
+
+optional<string> TwiliParser::find_class_like(const std::string& symbol_name, const std::string& cpp_context) const
 {
-  auto match = std::find(classes.begin(), classes.end(), cpp_context + "::" + symbol_name);
+  string match = cpp_context + "::" + symbol_name;
 
-  if (match == classes.end()) // not an exact match
+  if (!knows_class(match)) // not an exact match
   {
     auto parts = Crails::split(cpp_context, ':');
 
@@ -190,32 +387,88 @@ TwiliParser::ClassContext* TwiliParser::find_class_like(const std::string& symbo
       string parent_context;
       parts.remove(*parts.rbegin());
       for (const auto& part : parts) parent_context += "::" + part;
-      match = std::find(classes.begin(), classes.end(), parent_context + "::" + symbol_name);
+      match = parent_context + "::" + symbol_name;
     }
-    while (match == classes.end() && parts.size() > 0);
+    while (!knows_class(match) && parts.size() > 0);
   }
-  return match != classes.end() ? &(*match) : nullptr;
+  return knows_class(match) ? optional<string>(match) : optional<string>();
 }
 
-bool TwiliParser::operator()(CXTranslationUnit& unit)
+struct InclusionContext
+{
+  CXTranslationUnit unit;
+  TwiliParser&      parser;
+};
+
+static void visit_inclusion(CXFile included_file, CXSourceLocation* inclusion_stack, unsigned int depth, CXClientData data)
+{
+  InclusionContext& context = *reinterpret_cast<InclusionContext*>(data);
+  HeaderDefinition header;
+
+  header.path = path_of(included_file);
+  clang_getFileContents(context.unit, included_file, &header.size);
+  context.parser.add_header(header);
+  if (depth > 0)
+  {
+    HeaderDefinition includer;
+    CXFile includer_file;
+
+    clang_getSpellingLocation(inclusion_stack[0], &includer_file, nullptr, nullptr, nullptr);
+    includer.path = path_of(includer_file);
+    includer.includes.push_back(header.path);
+    context.parser.add_header(includer);
+  }
+}
+
+void TwiliParser::record_inclusions(CXTranslationUnit unit)
+{
+  InclusionContext context{unit, *this};
+
+  clang_getInclusions(unit, &visit_inclusion, &context);
+}
+
+void TwiliParser::visit(CXTranslationUnit& unit)
 {
   clang_visitChildren(
     clang_getTranslationUnitCursor(unit),
     &TwiliParser::visitor_callback,
-    nullptr
+    this
   );
+  end_unit(unit);
+}
+
+void TwiliParser::end_unit(CXTranslationUnit)
+{
+  scope.clear();
+  class_template_context = nullptr;
+  function_template_context = nullptr;
+}
+
+void TwiliParser::visit_indexed_declaration(const CXIdxDeclInfo* declaration)
+{
+  CXCursor container = declaration->lexicalContainer ? declaration->lexicalContainer->cursor : clang_getNullCursor();
+  CXCursorKind container_kind = clang_getCursorKind(container);
+
+  // members, enum constants and parameters are visited along with their parent
+  if (container_kind != CXCursor_TranslationUnit && container_kind != CXCursor_Namespace)
+    return ;
+  // namespaces which were filtered out, or declared outside of the scanned directories
+  if (container_kind == CXCursor_Namespace && scope.namespaces.find(container) == scope.namespaces.end())
+    return ;
+  if (visitor_callback(declaration->cursor, container, this) == CXChildVisit_Recurse && declaration->cursor.kind != CXCursor_Namespace)
+    clang_visitChildren(declaration->cursor, &TwiliParser::visitor_callback, this);
+}
+
+bool TwiliParser::operator()(CXTranslationUnit& unit)
+{
+  visit(unit);
   return !find_parsing_errors(unit);
 }
 
 void TwiliParser::register_type(const ClassContext& new_class)
 {
-  TypeDefinition type_definition;
-
-  type_definition.name = new_class.klass.name;
-  type_definition.scopes = Crails::split<std::string, std::vector<std::string>>(new_class.klass.cpp_context(), ':');
-  type_definition.type_full_name = new_class.klass.full_name;
-  type_definition.kind = new_class.klass.type == "struct" ? StructKind : ClassKind;
-  types.push_back(type_definition);
+  types.push_back(type_definition_for(new_class.klass));
+  publish_type(types.back());
   classes.push_back(new_class);
   function_template_context = nullptr;
 }
@@ -235,6 +488,37 @@ static bool are_types_identical(const TypeDefinition& a, const TypeDefinition& b
          a.type_full_name == b.type_full_name;
 }
 
+void TwiliParser::add_type(const TypeDefinition& definition)
+{
+  if (find_if(types.begin(), types.end(), bind(are_types_identical, definition, placeholders::_1)) == types.end())
+  {
+    types.push_back(definition);
+    publish_type(definition);
+  }
+}
+
+void TwiliParser::publish_type(const TypeDefinition& definition)
+{
+  if (shared_registry)
+    shared_registry->add_type(definition);
+}
+
+// Definitions seen by several parsers sharing a registry only get visited by
+// the first one to claim them. Forward declarations are only recorded while
+// no parser claimed the class, and get replaced by the definition on merge.
+bool TwiliParser::claim_class(const std::string& full_name)
+{
+  if (!shared_registry)
+    return true;
+  if (!clang_isCursorDefinition(cursor))
+  {
+    const TwiliParser* const* claimant = shared_registry->classes.find(full_name);
+
+    return !claimant || *claimant == this;
+  }
+  return *shared_registry->classes.insert(full_name, this).first == this;
+}
+
 CXChildVisitResult TwiliParser::visit_typedef(const std::string& symbol_name, CXCursor parent)
 {
   auto cpp_context = fullname_for(parent);
@@ -245,21 +529,12 @@ CXChildVisitResult TwiliParser::visit_typedef(const std::string& symbol_name, CX
     CXType type = clang_getTypedefDeclUnderlyingType(cursor);
     TypeDefinition pointed_from;
     TypeDefinition pointed_to;
-    TypeDefinition explicit_from;
+    optional<TypeDefinition> parent_type;
 
     pointed_from.load_from(type, types);
     pointed_to.load_from(typedefType, types);
     pointed_to.kind = TypedefKind;
-    explicit_from.name = pointed_from.name;
-    for (const auto& part : Crails::split(*cpp_context, ':'))
-      explicit_from.scopes.push_back(part);
-    for (const auto& part : pointed_from.scopes)
-      explicit_from.scopes.push_back(part);
-
-    optional<TypeDefinition> parent_type = explicit_from.find_parent_type(types);
-
-    if (!parent_type)
-      parent_type = pointed_from.find_parent_type(types);
+    parent_type = pointed_from.find_parent_type(types);
     if (parent_type)
     {
       pointed_to.type_full_name = parent_type->type_full_name;
@@ -268,43 +543,89 @@ CXChildVisitResult TwiliParser::visit_typedef(const std::string& symbol_name, CX
       pointed_to.is_reference += parent_type->is_reference;
     }
     else
-    {
-      TypeDefinition definite_type;
-      definite_type.load_from(cxStringToStdString(clang_getTypeSpelling(type)), types);
-      pointed_to.type_full_name = Crails::join(definite_type.scopes, "::") + "::" + definite_type.name;
-    }
-    pointed_to.declaration_scope = explicit_from.scopes;
+      pointed_to.type_full_name = TypeReference(type).full_name();
+    pointed_to.declaration_scope = Crails::split<string, vector<string>>(*cpp_context, ':');
     pointed_to.is_const = pointed_to.is_const || pointed_from.is_const;
     pointed_to.is_pointer += pointed_from.is_pointer;
     pointed_to.is_reference += pointed_from.is_reference;
     if (find_if(types.begin(), types.end(), bind(are_types_identical, pointed_to, placeholders::_1)) == types.end())
+    {
       types.push_back(pointed_to);
+      publish_type(pointed_to);
+    }
   }
-  else
+  else if (verbose)
     cerr << "(i) Could not solve typedef " << symbol_name << endl;
   return CXChildVisit_Continue;
 }
 
 CXChildVisitResult TwiliParser::visit_namespace(const std::string& symbol_name, CXCursor parent)
 {
+  // inline namespaces are left out of full names, as in TypeReference: their
+  // content gets named the way it is spelled from the enclosing namespace
+  if (clang_Cursor_isInlineNamespace(cursor))
+  {
+    auto enclosing = scope.namespaces.find(parent);
+
+    if (enclosing != scope.namespaces.end())
+      scope.namespaces.emplace(cursor, enclosing->second);
+    else if (parent.kind == CXCursor_TranslationUnit)
+      scope.namespaces.emplace(cursor, TranslationUnitScope::global_scope);
+    else
+      return CXChildVisit_Continue;
+    return CXChildVisit_Recurse;
+  }
   auto base_name = fullname_for(parent);
   auto full_name = (base_name ? *base_name : string()) + "::" + symbol_name;
   auto it = std::find(namespaces.begin(), namespaces.end(), full_name);
 
+  if (!filter.accepts_namespace(full_name))
+    return CXChildVisit_Continue;
   if (it == namespaces.end())
   {
     NamespaceContext ns_context;
 
-    ns_context.cursors.push_back(cursor);
     ns_context.ns.name = symbol_name;
     ns_context.ns.full_name = full_name;
+    scope.namespaces.emplace(cursor, namespaces.size());
     namespaces.push_back(ns_context);
   }
   else
-    it->cursors.push_back(cursor);
+    scope.namespaces.emplace(cursor, std::distance(namespaces.begin(), it));
   return CXChildVisit_Recurse;
 }
 
+static LayoutDefinition layout_of(CXCursor cursor)
+{
+  CXType type = clang_getCursorType(cursor);
+  LayoutDefinition layout;
+
+  if (type.kind == CXType_LValueReference || type.kind == CXType_RValueReference)
+  {
+    // libclang measures the referenced type, while members store a pointer
+    CXTargetInfo target = clang_getTranslationUnitTargetInfo(clang_Cursor_getTranslationUnit(cursor));
+
+    layout.size = layout.alignment = clang_TargetInfo_getPointerWidth(target) / 8;
+    clang_TargetInfo_dispose(target);
+  }
+  else
+  {
+    layout.size = clang_Type_getSizeOf(type);
+    layout.alignment = clang_Type_getAlignOf(type);
+  }
+  return layout;
+}
+
+// Sizes made up by error recovery are left unknown, and so are the traits.
+static void load_class_layout(ClassDefinition& klass, CXCursor cursor, RecordTraitsCache& cache)
+{
+  if (!clang_isInvalidDeclaration(cursor))
+  {
+    klass.layout = layout_of(cursor);
+    klass.load_traits(clang_getCursorType(cursor), cache);
+  }
+}
+
 CXChildVisitResult TwiliParser::visit_class(const std::string& symbol_name, CXCursor parent)
 {
   auto kind = clang_getCursorKind(cursor);
@@ -315,14 +636,14 @@ CXChildVisitResult TwiliParser::visit_class(const std::string& symbol_name, CXCu
   new_class.klass.name = symbol_name;
   new_class.klass.from_file = get_current_path().string();
   new_class.klass.include_path = get_relative_path();
-  new_class.cursors.push_back(cursor);
   new_class.current_access = kind == CXCursor_StructDecl ? CX_CXXPublic : CX_CXXPrivate;
   new_class.klass.type = kind == CXCursor_StructDecl ? "struct" : "class";
+  new_class.klass.has_definition = clang_isCursorDefinition(cursor);
   if (parent.kind == CXCursor_TranslationUnit)
     new_class.klass.full_name = "::" + symbol_name;
   else if ((parent_class = find_class_for(parent)))
   {
-    if (parent_class->current_access != CX_CXXPublic)
+    if (parent_class->current_access != CX_CXXPublic || !accepts_member(*parent_class))
       return CXChildVisit_Continue;
     new_class.klass.full_name = parent_class->klass.full_name + "::" + symbol_name;
   }
@@ -338,17 +659,25 @@ CXChildVisitResult TwiliParser::visit_class(const std::string& symbol_name, CXCu
       return CXChildVisit_Continue;
     }
   }
+  if (!filter.accepts_symbol(new_class.klass.full_name) || !claim_class(new_class.klass.full_name))
+    return CXChildVisit_Continue;
   existing_class = find_class_by_name(new_class.klass.full_name);
   if (existing_class != nullptr)
   {
-    if (existing_class->klass.is_empty())
-    {
-      existing_class->klass.from_file = get_current_path().string();
-      existing_class->klass.include_path = get_relative_path();
-    }
-    existing_class->cursors.push_back(cursor);
-    return existing_class->klass.is_empty() ? CXChildVisit_Recurse : CXChildVisit_Continue;
+    // forward declarations and definitions visited before have nothing to add
+    if (!new_class.klass.has_definition || existing_class->klass.has_definition)
+      return CXChildVisit_Continue;
+    existing_class->klass.from_file = new_class.klass.from_file;
+    existing_class->klass.include_path = new_class.klass.include_path;
+    existing_class->klass.has_definition = true;
+    if (detail_level == FullLevel)
+      load_class_layout(existing_class->klass, cursor, scope.record_traits);
+    scope.classes.emplace(cursor, existing_class - classes.data());
+    return CXChildVisit_Recurse;
   }
+  if (detail_level == FullLevel && new_class.klass.has_definition)
+    load_class_layout(new_class.klass, cursor, scope.record_traits);
+  scope.classes.emplace(cursor, classes.size());
   register_type(new_class);
   return CXChildVisit_Recurse;
 }
@@ -379,12 +708,12 @@ void TwiliParser::visit_base_class(ClassContext& current_class, const std::strin
   string symbol_name = strip_declaration_type_from_class_declaration(
     remove_template_parameters(cursor_text)
   );
-  ClassContext* base_class = find_class_like(symbol_name, current_class.klass.full_name);
+  optional<string> base_class = find_class_like(symbol_name, current_class.klass.full_name);
 
   if (base_class)
   {
-    current_class.klass.bases.push_back(base_class->klass.full_name);
-    current_class.klass.known_bases.push_back(base_class->klass.full_name);
+    current_class.klass.bases.push_back(*base_class);
+    current_class.klass.known_bases.push_back(*base_class);
   }
   else
   {
@@ -410,26 +739,205 @@ static void set_visibility_on(MODEL& model, CX_CXXAccessSpecifier access)
   }
 }
 
+static int angle_bracket_delta(const string& token)
+{
+  if (token == "<")
+    return 1;
+  else if (token == ">")
+    return -1;
+  else if (token == ">>")
+    return -2;
+  return 0;
+}
+
+static void append_token(string& result, CXTokenKind kind, const string& token, CXTokenKind& last_kind)
+{
+  bool is_word = kind == CXToken_Identifier || kind == CXToken_Keyword;
+
+  if (is_word && (last_kind == CXToken_Identifier || last_kind == CXToken_Keyword))
+    result += ' ';
+  result += token;
+  last_kind = kind;
+}
+
+// Rebuilds the type of a declaration from its tokens, stopping at the
+// declared name, a default value or a parameter list.
+static string spelled_type_of(CXCursor cursor, const string& name)
+{
+  static const vector<string> specifiers{"virtual", "static", "inline", "explicit", "constexpr", "friend", "extern", "mutable"};
+  CXTranslationUnit unit = clang_Cursor_getTranslationUnit(cursor);
+  CXToken* tokens = nullptr;
+  unsigned int token_count = 0;
+  CXTokenKind last_kind = CXToken_Punctuation;
+  bool in_template_header = false;
+  int depth = 0;
+  string result;
+
+  clang_tokenize(unit, clang_getCursorExtent(cursor), &tokens, &token_count);
+  for (unsigned int i = 0 ; i < token_count ; ++i)
+  {
+    CXTokenKind kind = clang_getTokenKind(tokens[i]);
+    string token = cxStringToStdString(clang_getTokenSpelling(unit, tokens[i]));
+
+    if (i == 0 && token == "template")
+      in_template_header = true;
+    else if (in_template_header)
+    {
+      int delta = angle_bracket_delta(token);
+
+      depth += delta;
+      in_template_header = depth > 0 || delta == 0;
+    }
+    else if (depth == 0 && (token == name || token == "=" || token == "(" || token == ";" || token == "operator"))
+      break ;
+    else if (kind != CXToken_Keyword || std::find(specifiers.begin(), specifiers.end(), token) == specifiers.end())
+    {
+      append_token(result, kind, token, last_kind);
+      depth += angle_bracket_delta(token);
+    }
+  }
+  clang_disposeTokens(unit, tokens, token_count);
+  return result;
+}
+
+// Unnamed parameters of unknown types have an empty extent, located right
+// after where their type was written: the type gets spelled from the tokens
+// of the function preceding that location, back to the previous separator.
+static string spelled_type_before(CXCursor function, CXCursor param)
+{
+  CXTranslationUnit unit = clang_Cursor_getTranslationUnit(function);
+  CXToken* tokens = nullptr;
+  unsigned int token_count = 0;
+  unsigned int param_offset = 0;
+  unsigned int begin, end = 0;
+  CXTokenKind last_kind = CXToken_Punctuation;
+  int depth = 0;
+  string result;
+
+  clang_getSpellingLocation(clang_getCursorLocation(param), nullptr, nullptr, nullptr, &param_offset);
+  clang_tokenize(unit, clang_getCursorExtent(function), &tokens, &token_count);
+  for (unsigned int offset = 0 ; end < token_count ; ++end)
+  {
+    clang_getSpellingLocation(clang_getTokenLocation(unit, tokens[end]), nullptr, nullptr, nullptr, &offset);
+    if (offset >= param_offset)
+      break ;
+  }
+  for (begin = end ; begin > 0 ; --begin)
+  {
+    string token = cxStringToStdString(clang_getTokenSpelling(unit, tokens[begin - 1]));
+
+    if (depth == 0 && (token == "(" || token == ","))
+      break ;
+    if (token == ")" || token == "(")
+      depth += token == ")" ? 1 : -1;
+    else
+      depth -= angle_bracket_delta(token);
+  }
+  for (unsigned int i = begin ; i < end ; ++i)
+    append_token(result, clang_getTokenKind(tokens[i]), cxStringToStdString(clang_getTokenSpelling(unit, tokens[i])), last_kind);
+  clang_disposeTokens(unit, tokens, token_count);
+  return result;
+}
+
+// Declarations clang could not make sense of, such as those using types
+// from headers skipped by single-file parsing, get their types spelled from
+// tokens, then matched against the type registry once the scan is done.
+ParamDefinition TwiliParser::create_param(CXCursor param_cursor, CXType type, const vector<string>& declaration_scope)
+{
+  if (!clang_Cursor_isNull(param_cursor) && clang_isInvalidDeclaration(param_cursor))
+  {
+    ParamDefinition param;
+    string spelled_type;
+
+    param.name = cxStringToStdString(clang_getCursorSpelling(param_cursor));
+    spelled_type = spelled_type_of(param_cursor, param.name);
+    if (spelled_type.length() == 0 && param.name.length() > 0)
+    {
+      spelled_type = param.name; // a type name taken for the parameter name
+      param.name.clear();
+    }
+    else if (spelled_type.length() == 0)
+      spelled_type = spelled_type_before(cursor, param_cursor);
+    if (spelled_type.length() > 0)
+    {
+      param.load_spelled_type(spelled_type, declaration_scope);
+      return param;
+    }
+  }
+  if (param_cursor.kind != 0 && clang_getCursorType(param_cursor).kind != 0)
+    return ParamDefinition(param_cursor, types, deferred_resolution);
+  return ParamDefinition(type, types, deferred_resolution);
+}
+
+void TwiliParser::load_signature(InvokableDefinition& invokable, const string& symbol_name, CXCursor parent)
+{
+  CXType function_type = clang_getCursorType(cursor);
+  CXType return_type = clang_getResultType(function_type);
+  CXType arg_type;
+  auto context_name = fullname_for(parent);
+  vector<string> declaration_scope;
+
+  if (context_name)
+    declaration_scope = Crails::split<string, vector<string>>(*context_name, ':');
+  if (clang_isInvalidDeclaration(cursor))
+  {
+    string spelled_type = spelled_type_of(cursor, symbol_name);
+
+    if (spelled_type.length() > 0 && spelled_type != "void")
+      invokable.return_type.emplace().load_spelled_type(spelled_type, declaration_scope);
+  }
+  else if (return_type.kind != 0 && return_type.kind != CXType_Void)
+    invokable.return_type = ParamDefinition(return_type, types, deferred_resolution);
+  for (int i = 0 ; (arg_type = clang_getArgType(function_type, i)).kind != 0 ; ++i)
+    invokable.params.push_back(create_param(clang_Cursor_getArgument(cursor, i), arg_type, declaration_scope));
+}
+
 CXChildVisitResult TwiliParser::visit_field(ClassContext& current_class, const string& symbol_name, bool is_static)
 {
-  FieldDefinition field(cursor, types);
+  FieldDefinition field;
+  vector<string> declaration_scope = Crails::split<string, vector<string>>(current_class.klass.full_name, ':');
+
+  string spelled_type = clang_isInvalidDeclaration(cursor) ? spelled_type_of(cursor, symbol_name) : string();
+
+  if (spelled_type.length() > 0)
+  {
+    field.name = symbol_name;
+    field.load_spelled_type(spelled_type, declaration_scope);
+  }
+  else
+    field = FieldDefinition(cursor, types, deferred_resolution);
   auto it = std::find(current_class.klass.fields.begin(), current_class.klass.fields.end(), field);
 
   if (it == current_class.klass.fields.end())
   {
     field.is_static = is_static;
+    if (!is_static && current_class.klass.layout.is_known() && !clang_isInvalidDeclaration(cursor))
+    {
+      field.layout = layout_of(cursor);
+      field.layout.offset = clang_Cursor_getOffsetOfField(cursor);
+      if (clang_Cursor_isBitField(cursor))
+        field.layout.bit_width = clang_getFieldDeclBitWidth(cursor);
+    }
     set_visibility_on(field, current_class.current_access);
     current_class.klass.fields.push_back(field);
   }
   return CXChildVisit_Continue;
 }
 
-MethodDefinition TwiliParser::create_method(const std::string& symbol_name, CXCursor)
+static CXChildVisitResult visit_virt_specifier(CXCursor cursor, CXCursor, CXClientData data)
+{
+  MethodDefinition& method = *reinterpret_cast<MethodDefinition*>(data);
+
+  if (clang_getCursorKind(cursor) == CXCursor_CXXFinalAttr)
+    method.is_final = true;
+  else if (clang_getCursorKind(cursor) == CXCursor_CXXOverrideAttr)
+    method.is_override = true;
+  return CXChildVisit_Continue;
+}
+
+MethodDefinition TwiliParser::create_method(const std::string& symbol_name, CXCursor parent)
 {
   MethodDefinition new_method;
-  CXType method_type = clang_getCursorType(cursor);
-  CXType return_type = clang_getResultType(method_type);
-  CXType arg_type;
 
   new_method.name = symbol_name;
   new_method.is_static = clang_CXXMethod_isStatic(cursor);
@@ -437,17 +945,10 @@ MethodDefinition TwiliParser::create_method(const std::string& symbol_name, CXCu
   new_method.is_pure_virtual = clang_CXXMethod_isPureVirtual(cursor);
   new_method.is_const = clang_CXXMethod_isConst(cursor);
   new_method.is_variadic = clang_Cursor_isVariadic(cursor);
-  if (return_type.kind != 0 && return_type.kind != CXType_Void)
-    new_method.return_type = ParamDefinition(return_type, types);
-  for (int i = 0 ; (arg_type = clang_getArgType(method_type, i)).kind != 0 ; ++i)
-  {
-    CXCursor arg_cursor = clang_Cursor_getArgument(cursor, i);
-
-    if (arg_cursor.kind != 0 && clang_getCursorType(arg_cursor).kind != 0)
-      new_method.params.push_back(ParamDefinition(arg_cursor, types));
-    else
-      new_method.params.push_back(ParamDefinition(arg_type, types));
-  }
+  new_method.load_traits(cursor);
+  if (new_method.is_virtual)
+    clang_visitChildren(cursor, &visit_virt_specifier, &new_method);
+  load_signature(new_method, symbol_name, parent);
   /*
   cout << "  -> with method `" << new_method.name << "`\n";
   if (new_method.return_type)
@@ -472,34 +973,73 @@ CXChildVisitResult TwiliParser::visit_method(ClassContext& current_class, const
   return CXChildVisit_Recurse;
 }
 
-FunctionDefinition TwiliParser::visit_function(const std::string& symbol_name, CXCursor parent)
+CXChildVisitResult TwiliParser::visit_function(const std::string& symbol_name, CXCursor parent)
 {
   FunctionDefinition new_func;
-  CXType method_type = clang_getCursorType(cursor);
-  CXType return_type = clang_getResultType(method_type);
-  CXType arg_type;
   auto context_name = fullname_for(parent);
 
   new_func.name = symbol_name;
-  new_func.is_variadic = clang_Cursor_isVariadic(cursor);
-  new_func.from_file = get_current_path().string();
-  new_func.include_path = get_relative_path();
   if (context_name)
     new_func.full_name = *context_name + "::" + new_func.name;
   else
     new_func.full_name = "::" + new_func.name;
-  if (return_type.kind != 0 && return_type.kind != CXType_Void)
-    new_func.return_type = ParamDefinition(return_type, types);
-  for (int i = 0 ; (arg_type = clang_getArgType(method_type, i)).kind != 0 ; ++i)
-    new_func.params.push_back(ParamDefinition(arg_type, types));
-  return new_func;
+  if (!filter.accepts_symbol(new_func.full_name))
+    return CXChildVisit_Continue;
+  new_func.is_variadic = clang_Cursor_isVariadic(cursor);
+  new_func.from_file = get_current_path().string();
+  new_func.include_path = get_relative_path();
+  if (detail_level == InventoryLevel)
+  {
+    add_function(new_func);
+    return CXChildVisit_Continue;
+  }
+  load_signature(new_func, symbol_name, parent);
+  std::size_t function_count = functions.size();
+
+  add_function(new_func); // declarations met again through other units are skipped
+  if (functions.size() > function_count && clang_getCursorKind(cursor) == CXCursor_FunctionTemplate)
+    function_template_context = &(*functions.rbegin());
+  return CXChildVisit_Continue;
+}
+
+// Non-type parameters are spelled from their type, template template
+// parameters from their tokens, keeping their own template header such as
+// `template<typename> class`.
+static string template_parameter_type(CXCursor cursor, const string& name)
+{
+  CXTranslationUnit unit;
+  CXToken* tokens = nullptr;
+  unsigned int token_count = 0;
+  CXTokenKind last_kind = CXToken_Punctuation;
+  int depth = 0;
+  string result;
+
+  if (clang_getCursorKind(cursor) == CXCursor_NonTypeTemplateParameter)
+    return cxStringToStdString(clang_getTypeSpelling(clang_getCursorType(cursor)));
+  unit = clang_Cursor_getTranslationUnit(cursor);
+  clang_tokenize(unit, clang_getCursorExtent(cursor), &tokens, &token_count);
+  for (unsigned int i = 0 ; i < token_count ; ++i)
+  {
+    CXTokenKind kind = clang_getTokenKind(tokens[i]);
+    string token = cxStringToStdString(clang_getTokenSpelling(unit, tokens[i]));
+
+    if (depth == 0 && (token == name || token == "="))
+      break ;
+    append_token(result, kind, token, last_kind);
+    depth += angle_bracket_delta(token);
+  }
+  clang_disposeTokens(unit, tokens, token_count);
+  return result;
 }
 
 CXChildVisitResult TwiliParser::visit_template_parameter(ClassContext& class_context, const string& symbol_name)
 {
-  class_template_context = &class_context;
+  bool is_type = clang_getCursorKind(cursor) == CXCursor_TemplateTypeParameter;
+
+  if (is_type)
+    class_template_context = &class_context;
   class_context.klass.template_parameters.push_back({
-    "typename",
+    is_type ? string("typename") : template_parameter_type(cursor, symbol_name),
     symbol_name
   });
   return CXChildVisit_Continue;
@@ -509,7 +1049,10 @@ CXChildVisitResult TwiliParser::visit_enum(const string& symbol_name, CXCursor p
 {
   auto cpp_context = fullname_for(parent).value_or("");
   auto existing_enum = std::find(enums.begin(), enums.end(), cpp_context + "::" + symbol_name);
+  ClassContext* parent_class = find_class_for(parent);
 
+  if ((parent_class && !accepts_member(*parent_class)) || !filter.accepts_symbol(cpp_context + "::" + symbol_name))
+    return CXChildVisit_Continue;
   if (existing_enum == enums.end())
   {
     EnumContext new_context;
@@ -517,7 +1060,9 @@ CXChildVisitResult TwiliParser::visit_enum(const string& symbol_name, CXCursor p
     new_context.en.name = symbol_name;
     new_context.en.full_name = cpp_context + "::" + symbol_name;
     new_context.en.from_file = get_current_path().string();
-    new_context.cursor = cursor;
+    new_context.en.include_path = get_relative_path();
+    if (parent_class)
+      set_visibility_on(new_context.en, parent_class->current_access);
 
     TypeDefinition type_definition;
     type_definition.kind = EnumKind;
@@ -525,6 +1070,8 @@ CXChildVisitResult TwiliParser::visit_enum(const string& symbol_name, CXCursor p
     type_definition.scopes = Crails::split<std::string, std::vector<std::string>>(cpp_context, ':');
     type_definition.type_full_name = new_context.en.full_name;
     types.push_back(type_definition);
+    publish_type(type_definition);
+    scope.enums.emplace(cursor, enums.size());
     enums.push_back(new_context);
   }
   return CXChildVisit_Recurse;
@@ -532,11 +1079,11 @@ CXChildVisitResult TwiliParser::visit_enum(const string& symbol_name, CXCursor p
 
 CXChildVisitResult TwiliParser::visit_enum_constant(const string& symbol_name, CXCursor parent)
 {
-  auto parent_enum = std::find(enums.begin(), enums.end(), parent);
+  auto parent_enum = scope.enums.find(parent);
 
-  if (parent_enum != enums.end())
+  if (parent_enum != scope.enums.end())
   {
-    parent_enum->en.flags.push_back({symbol_name, clang_getEnumConstantDeclValue(cursor)});
+    enums[parent_enum->second].en.flags.push_back({symbol_name, clang_getEnumConstantDeclValue(cursor)});
   }
   return CXChildVisit_Recurse;
 }
@@ -595,15 +1142,135 @@ optional<CXChildVisitResult> TwiliParser::try_to_visit_template_parameter(const
   return {};
 }
 
+constexpr TwiliCursorHandlers TwiliParser::make_default_handlers()
+{
+  TwiliCursorHandlers table{};
+  TwiliCursorHandler member = [](TwiliParser& parser, CXCursor, const string& symbol_name, CXCursor parent)
+  {
+    return parser.visit_class_member(symbol_name, parent);
+  };
+  TwiliCursorHandler klass = [](TwiliParser& parser, CXCursor, const string& symbol_name, CXCursor parent)
+  {
+    return parser.visit_class(symbol_name, parent);
+  };
+
+  table[CXCursor_Namespace] = [](TwiliParser& parser, CXCursor, const string& symbol_name, CXCursor parent)
+  {
+    return parser.visit_namespace(symbol_name, parent);
+  };
+  table[CXCursor_TypedefDecl] = [](TwiliParser& parser, CXCursor, const string& symbol_name, CXCursor parent)
+  {
+    return parser.detail_level > InventoryLevel ? parser.visit_typedef(symbol_name, parent) : CXChildVisit_Continue;
+  };
+  table[CXCursor_EnumDecl] = [](TwiliParser& parser, CXCursor, const string& symbol_name, CXCursor parent)
+  {
+    return parser.visit_enum(symbol_name, parent);
+  };
+  table[CXCursor_EnumConstantDecl] = [](TwiliParser& parser, CXCursor, const string& symbol_name, CXCursor parent)
+  {
+    return parser.visit_enum_constant(symbol_name, parent);
+  };
+  table[CXCursor_StructDecl] = table[CXCursor_ClassDecl] = table[CXCursor_ClassTemplate] = klass;
+  for (CXCursorKind kind : {CXCursor_TemplateTypeParameter, CXCursor_NonTypeTemplateParameter, CXCursor_TemplateTemplateParameter,
+                            CXCursor_CXXBaseSpecifier, CXCursor_CXXAccessSpecifier, CXCursor_CXXFinalAttr,
+                            CXCursor_FunctionTemplate, CXCursor_FunctionDecl, CXCursor_CXXMethod, CXCursor_Constructor,
+                            CXCursor_FieldDecl, CXCursor_VarDecl})
+    table[kind] = member;
+  return table;
+}
+
+constexpr TwiliCursorHandlers TwiliParser::default_handlers = TwiliParser::make_default_handlers();
+
+void TwiliParser::set_handler(CXCursorKind kind, TwiliCursorHandler handler)
+{
+  if (static_cast<size_t>(kind) >= handlers.size())
+    throw out_of_range("TwiliParser::set_handler: unknown cursor kind " + std::to_string(kind));
+  handlers[kind] = handler;
+}
+
+TwiliCursorHandler TwiliParser::get_handler(CXCursorKind kind) const
+{
+  return static_cast<size_t>(kind) < handlers.size() ? handlers[kind] : nullptr;
+}
+
+CXChildVisitResult TwiliParser::visit_class_member(const string& symbol_name, CXCursor parent)
+{
+  ClassContext* current_class = find_class_for(parent);
+  auto kind = clang_getCursorKind(cursor);
+
+  if (!current_class)
+  {
+    if (kind == CXCursor_FunctionDecl || kind == CXCursor_FunctionTemplate)
+      return visit_function(symbol_name, parent);
+    return CXChildVisit_Continue;
+  }
+  if (detail_level == InventoryLevel && kind != CXCursor_CXXAccessSpecifier && kind != CXCursor_CXXFinalAttr)
+    return CXChildVisit_Continue;
+  switch (kind)
+  {
+  case CXCursor_TemplateTypeParameter:
+    visit_template_parameter(*current_class, symbol_name);
+    break ;
+  case CXCursor_NonTypeTemplateParameter:
+  case CXCursor_TemplateTemplateParameter:
+    return visit_template_parameter(*current_class, symbol_name);
+  case CXCursor_CXXBaseSpecifier:
+    visit_base_class(*current_class, symbol_name);
+    break ;
+  case CXCursor_CXXAccessSpecifier:
+    current_class->current_access = clang_getCXXAccessSpecifier(cursor);
+    break ;
+  case CXCursor_CXXFinalAttr:
+    current_class->klass.is_final = true;
+    break ;
+  case CXCursor_FunctionTemplate:
+  case CXCursor_CXXMethod:
+  case CXCursor_Constructor:
+    if (!accepts_member(*current_class))
+    {
+      function_template_context = nullptr;
+      return CXChildVisit_Continue;
+    }
+    return visit_method(*current_class, symbol_name, parent);
+  case CXCursor_FieldDecl:
+  case CXCursor_VarDecl:
+    if (detail_level < FullLevel || !accepts_member(*current_class))
+      return CXChildVisit_Continue;
+    return visit_field(*current_class, symbol_name, kind == CXCursor_VarDecl);
+  default:
+    break ;
+  }
+  return CXChildVisit_Recurse;
+}
+
+// Cursors without a handler are skipped, unless they sit in a class: then
+// their children still get visited, as they may declare members.
+CXChildVisitResult TwiliParser::visit_unhandled(CXCursor parent)
+{
+  bool in_class = parent.kind == CXCursor_StructDecl || parent.kind == CXCursor_ClassDecl || parent.kind == CXCursor_ClassTemplate;
+
+  if (in_class && detail_level > InventoryLevel && find_class_for(parent))
+    return CXChildVisit_Recurse;
+  return CXChildVisit_Continue;
+}
+
 CXChildVisitResult TwiliParser::visitor(CXCursor parent, CXClientData)
 {
-  print_state();
+  auto kind = clang_getCursorKind(cursor);
+  TwiliCursorHandler handler = get_handler(kind);
+
+  if (verbose)
+    print_state();
+  // resolving the file of a cursor is costly: it is skipped for the cursors
+  // which would neither be handled nor recursed into
+  if (!handler && !class_template_context && !function_template_context && visit_unhandled(parent) == CXChildVisit_Continue)
+    return CXChildVisit_Continue;
   if (is_included(get_current_path()))
   {
-    auto kind = clang_getCursorKind(cursor);
-    string symbol_name = cxStringToStdString(clang_getCursorSpelling(cursor));
+    string symbol_name;
 
-    //cout << "Decl: " << clang_getCursorKindSpelling(clang_getCursorKind(cursor)) << " -> " <<  symbol_name << endl;
+    if (handler || class_template_context || function_template_context)
+      symbol_name = cxStringToStdString(clang_getCursorSpelling(cursor));
     if (class_template_context)
     {
       if (kind == CXCursor_TypeRef)
@@ -615,64 +1282,27 @@ CXChildVisitResult TwiliParser::visitor(CXCursor parent, CXClientData)
       auto result = try_to_visit_template_parameter(symbol_name, parent);
       if (result) return *result;
     }
-    if (kind == CXCursor_Namespace)
-      return visit_namespace(symbol_name, parent);
-    else if (kind == CXCursor_TypedefDecl)
-      return visit_typedef(symbol_name, parent);
-    else if (kind == CXCursor_EnumDecl)
-      return visit_enum(symbol_name, parent);
-    else if (kind == CXCursor_EnumConstantDecl)
-      return visit_enum_constant(symbol_name, parent);
-    else if (kind == CXCursor_StructDecl || kind == CXCursor_ClassDecl || kind == CXCursor_ClassTemplate)
-      return visit_class(symbol_name, parent);
-    else
-    {
-      ClassContext* current_class = find_class_for(parent);
-
-      if (current_class)
-      {
-        switch (kind)
-        {
-        case CXCursor_TemplateTypeParameter:
-          visit_template_parameter(*current_class, symbol_name);
-          break ;
-        case CXCursor_CXXBaseSpecifier:
-          visit_base_class(*current_class, symbol_name);
-          break ;
-        case CXCursor_CXXAccessSpecifier:
-          current_class->current_access = clang_getCXXAccessSpecifier(cursor);
-          break ;
-        case CXCursor_FunctionTemplate:
-        case CXCursor_CXXMethod:
-          return visit_method(*current_class, symbol_name, parent);
-        case CXCursor_FieldDecl:
-          return visit_field(*current_class, symbol_name, false);
-        case CXCursor_VarDecl:
-          return visit_field(*current_class, symbol_name, true);
-        case CXCursor_Constructor:
-          return visit_method(*current_class, symbol_name, parent);
-        default:
-          //TWILOG("  Unhandled decl: " << clang_getCursorKindSpelling(clang_getCursorKind(cursor)) << " -> " <<  symbol_name);
-          break ;
-        }
-        return CXChildVisit_Recurse;
-      }
-      else if (kind == CXCursor_FunctionDecl || kind == CXCursor_FunctionTemplate)
-      {
-        functions.push_back(visit_function(symbol_name, parent));
-        if (kind == CXCursor_FunctionTemplate)
-          function_template_context = &(*functions.rbegin());
-        return CXChildVisit_Continue;
-      }
-      else
-        TWILOG("Unhandled decl: " << clang_getCursorKindSpelling(clang_getCursorKind(cursor)) << " -> " <<  symbol_name);
-    }
+    return handler ? handler(*this, cursor, symbol_name, parent) : visit_unhandled(parent);
   }
   return CXChildVisit_Continue;
 }
 
 CXChildVisitResult TwiliParser::visitor_callback(CXCursor c, CXCursor parent, CXClientData clientData)
 {
+  TwiliParser* parser = reinterpret_cast<TwiliParser*>(clientData);
+
   parser->cursor = c;
+  if (parser->monitor)
+  {
+    if (parser->monitor->cancelled.load(memory_order_relaxed))
+      return CXChildVisit_Break;
+    parser->monitor->cursors_visited.fetch_add(1, memory_order_relaxed);
+    parser->monitor->symbols_found.store(parser->symbol_count(), memory_order_relaxed);
+  }
   return parser->visitor(parent, clientData);
 }
+
+size_t TwiliParser::symbol_count() const
+{
+  return namespaces.size() + classes.size() + enums.size() + functions.size();
+}
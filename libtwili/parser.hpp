@@ -1,8 +1,44 @@
 #pragma once
 #include "definitions.hpp"
+#include "filter.hpp"
 #include <filesystem>
 #include <optional>
 #include <algorithm>
+#include <unordered_map>
+#include <map>
+#include <atomic>
+#include <array>
+#include <cstdint>
+
+// Shared with other threads while a scan is running: the counters are only
+// updated with relaxed atomic operations, so reading them never blocks the
+// scan, and setting `cancelled` stops it at the next cursor or file.
+struct TwiliScanMonitor
+{
+  std::atomic<bool>          cancelled{false};
+  std::atomic<std::size_t>   files_total{0};
+  std::atomic<std::size_t>   files_done{0};
+  std::atomic<std::uint64_t> cursors_visited{0};
+  std::atomic<std::size_t>   symbols_found{0};
+};
+
+class TwiliParser;
+struct TwiliSharedRegistry;
+
+// Handlers are picked by cursor kind, and receive the cursor with its spelling
+// and parent. The spelling is only fetched for kinds which have a handler.
+typedef CXChildVisitResult (*TwiliCursorHandler)(TwiliParser&, CXCursor, const std::string& symbol_name, CXCursor parent);
+typedef std::array<TwiliCursorHandler, CXCursor_OverloadCandidate + 1> TwiliCursorHandlers;
+
+// Inventory only records namespaces, classes, enums and function names,
+// signatures adds methods, bases, typedefs and parameter types, and full
+// also adds fields and the include graph.
+enum TwiliDetailLevel
+{
+  InventoryLevel = 1,
+  SignaturesLevel,
+  FullLevel
+};
 
 class TwiliParser
 {
@@ -10,55 +46,59 @@ class TwiliParser
   {
     ClassDefinition       klass;
     CX_CXXAccessSpecifier current_access;
-    std::vector<CXCursor> cursors;
     bool operator==(const std::string& value) const { return klass.full_name == value; }
-    bool operator==(const CXCursor value) const
-    {
-      auto it = std::find_if(cursors.begin(), cursors.end(), [&value](const CXCursor candidate)
-      {
-        return clang_equalCursors(value, candidate);
-      });
-      return it != cursors.end();
-    }
   };
 
   struct NamespaceContext
   {
     NamespaceDefinition   ns;
-    std::vector<CXCursor> cursors;
     ClassContext          current_class;
     bool operator==(const std::string& value) const { return ns.full_name == value; }
-    bool operator==(const CXCursor value) const
-    {
-      auto it = std::find_if(cursors.begin(), cursors.end(), [&value](const CXCursor candidate)
-      {
-        return clang_equalCursors(value, candidate);
-      });
-      return it != cursors.end();
-    }
   };
 
   struct EnumContext
   {
     EnumDefinition en;
-    CXCursor cursor;
     bool operator==(const std::string& value) const { return en.full_name == value; }
-    bool operator==(const CXCursor value) const { return clang_equalCursors(value, cursor); }
     operator EnumDefinition() const { return en; }
   };
 
+  // Cursors are only meaningful while their translation unit is alive:
+  // this scratch area maps them to indexes in the persistent model, and
+  // is cleared once each unit has been visited.
+  struct TranslationUnitScope
+  {
+    static constexpr std::size_t global_scope = static_cast<std::size_t>(-1); // inline namespaces at file scope
+    CursorMap<std::size_t> classes;
+    CursorMap<std::size_t> namespaces;
+    CursorMap<std::size_t> enums;
+    RecordTraitsCache      record_traits;
+    void clear();
+  };
+
   std::vector<std::string>        directories;
+  TwiliFilter                     filter;
   std::vector<TypeDefinition>     types;
   std::vector<ClassContext>       classes;
   std::vector<NamespaceContext>   namespaces;
   std::vector<FunctionDefinition> functions;
   std::vector<EnumContext>        enums;
+  std::map<std::string, HeaderDefinition> headers;
+  TranslationUnitScope            scope;
+  TwiliCursorHandlers             handlers;
   NamespaceContext                current_ns;
   NamespaceDefinition             root_ns;
   CXCursor                        cursor;
+  TwiliDetailLevel                detail_level = FullLevel;
+  bool                            deferred_resolution = false;
+  bool                            verbose = true;
+  TwiliScanMonitor*               monitor = nullptr;
+  TwiliSharedRegistry*            shared_registry = nullptr;
   ClassContext*                   class_template_context = nullptr;
   InvokableDefinition*            function_template_context = nullptr;
 public:
+  static const TwiliCursorHandlers default_handlers;
+
   TwiliParser();
   TwiliParser(const TwiliParser&) = delete;
   ~TwiliParser();
@@ -66,19 +106,52 @@ public:
   void add_directory(const std::string& path);
   void add_directory(const std::filesystem::path& path);
   const std::vector<std::string>& get_directories() const { return directories; }
+  void set_filter(const TwiliFilter& value) { filter = value; }
+  const TwiliFilter& get_filter() const { return filter; }
+  void set_deferred_resolution(bool value) { deferred_resolution = value; }
+  bool has_deferred_resolution() const { return deferred_resolution; }
+  void set_detail_level(TwiliDetailLevel value) { detail_level = value; }
+  TwiliDetailLevel get_detail_level() const { return detail_level; }
+  unsigned int translation_unit_flags() const;
+  void set_verbose(bool value) { verbose = value; }
+  bool is_verbose() const { return verbose; }
+  void set_monitor(TwiliScanMonitor* value) { monitor = value; }
+  TwiliScanMonitor* get_monitor() const { return monitor; }
+  void set_shared_registry(TwiliSharedRegistry* value) { shared_registry = value; }
+  TwiliSharedRegistry* get_shared_registry() const { return shared_registry; }
+  std::size_t symbol_count() const;
+  void set_handler(CXCursorKind, TwiliCursorHandler); // nullptr drops the kind
+  TwiliCursorHandler get_handler(CXCursorKind) const;
+  void set_handlers(const TwiliCursorHandlers& value) { handlers = value; }
+  const TwiliCursorHandlers& get_handlers() const { return handlers; }
   std::vector<ClassDefinition> get_classes() const;
   std::vector<NamespaceDefinition> get_namespaces() const;
   const std::vector<FunctionDefinition>& get_functions() const { return functions; }
   const std::vector<TypeDefinition>& get_types() const { return types; }
   std::vector<EnumDefinition> get_enums() const;
+  const std::map<std::string, HeaderDefinition>& get_headers() const { return headers; }
+
+  void add_namespace(const NamespaceDefinition&);
+  void add_class(const ClassDefinition&);
+  void add_enum(const EnumDefinition&);
+  void add_function(const FunctionDefinition&);
+  void add_type(const TypeDefinition&);
+  void add_header(const HeaderDefinition&);
+  void merge(const TwiliParser&);
+  std::vector<std::string> resolve_types(unsigned int thread_count = 0);
 
   std::filesystem::path get_current_path() const;
   std::string           get_relative_path() const;
   bool                  is_included(const std::filesystem::path& path) const;
   bool                  has_class(const std::string& class_name) const;
+  void                  visit(CXTranslationUnit& unit);
+  void                  visit_indexed_declaration(const CXIdxDeclInfo*);
+  void                  end_unit(CXTranslationUnit unit);
+  void                  record_inclusions(CXTranslationUnit unit);
   bool                  operator()(CXTranslationUnit& unit);
 
 private:
+  static constexpr TwiliCursorHandlers make_default_handlers();
   static CXChildVisitResult visitor_callback(CXCursor c, CXCursor parent, CXClientData clientData);
 
   CXChildVisitResult visitor(CXCursor parent, CXClientData clientData);
@@ -89,18 +162,26 @@ private:
   void               visit_base_class(ClassContext& class_context, const std::string& symbol_name);
   CXChildVisitResult visit_namespace(const std::string& symbol_name, CXCursor parent);
   CXChildVisitResult visit_typedef(const std::string& symbol_name, CXCursor parent);
-  FunctionDefinition visit_function(const std::string& symbol_name, CXCursor parent);
+  CXChildVisitResult visit_function(const std::string& symbol_name, CXCursor parent);
   CXChildVisitResult visit_field(ClassContext&, const std::string& symbol_name, bool is_static);
   CXChildVisitResult visit_enum(const std::string& symbol_name, CXCursor parent);
   CXChildVisitResult visit_enum_constant(const std::string& symbol_name, CXCursor parent);
+  CXChildVisitResult visit_class_member(const std::string& symbol_name, CXCursor parent);
+  CXChildVisitResult visit_unhandled(CXCursor parent);
   std::optional<CXChildVisitResult> try_to_visit_template_parameter(const std::string& symbol_name, CXCursor parent);
 
+  bool accepts_member(const ClassContext&) const;
   std::optional<std::string> fullname_for(CXCursor) const;
   ClassContext* find_class_for(CXCursor);
   ClassContext* find_class_by_name(const std::string& full_name);
-  ClassContext* find_class_like(const std::string& symbol_name, const std::string& cpp_context);
+  bool knows_class(const std::string& full_name) const;
+  std::optional<std::string> find_class_like(const std::string& symbol_name, const std::string& cpp_context) const;
+  bool claim_class(const std::string& full_name);
+  void publish_type(const TypeDefinition&);
 
   MethodDefinition create_method(const std::string& symbol_name, CXCursor parent);
+  ParamDefinition create_param(CXCursor param_cursor, CXType type, const std::vector<std::string>& declaration_scope);
+  void load_signature(InvokableDefinition&, const std::string& symbol_name, CXCursor parent);
   void register_type(const ClassContext&);
   std::string solve_typeref(CXCursor context);
   void print_state();
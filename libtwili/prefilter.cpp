@@ -0,0 +1,254 @@
+#include "prefilter.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+# define TWILI_HAS_MMAP
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#else
+# include <fstream>
+# include <iterator>
+#endif
+#include <array>
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static const array<string_view, 9> declaration_keywords{
+  "class", "struct", "union", "enum", "namespace", "typedef", "using", "template", "operator"
+};
+
+static bool is_identifier_char(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
+
+static bool is_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static size_t find_char(string_view source, char c, size_t from)
+{
+  const void* match = memchr(source.data() + from, c, source.size() - from);
+
+  return match ? static_cast<const char*>(match) - source.data() : source.size();
+}
+
+// Returns the position following the end of a line, skipping escaped newlines.
+static size_t skip_line(string_view source, size_t i)
+{
+  for (;;)
+  {
+    i = find_char(source, '\n', i);
+    if (i >= source.size())
+      return i;
+    if (i > 0 && (source[i - 1] == '\\' || (source[i - 1] == '\r' && i > 1 && source[i - 2] == '\\')))
+      i++;
+    else
+      return i + 1;
+  }
+}
+
+static size_t skip_block_comment(string_view source, size_t i)
+{
+  for (i += 2 ; (i = find_char(source, '*', i)) < source.size() ; ++i)
+  {
+    if (i + 1 < source.size() && source[i + 1] == '/')
+      return i + 2;
+  }
+  return source.size();
+}
+
+static size_t skip_quoted(string_view source, size_t i)
+{
+  char quote = source[i];
+
+  for (++i ; i < source.size() ; ++i)
+  {
+    if (source[i] == '\\')
+      i++;
+    else if (source[i] == quote || source[i] == '\n')
+      return i + 1;
+  }
+  return source.size();
+}
+
+static string_view read_word(string_view source, size_t& i)
+{
+  size_t start;
+
+  while (i < source.size() && is_space(source[i]))
+    i++;
+  start = i;
+  while (i < source.size() && is_identifier_char(source[i]))
+    i++;
+  return source.substr(start, i - start);
+}
+
+// Only headers get scanned on their own: other included files (.inl, .ipp,
+// .def, ...) may hold declarations which the including file alone exposes.
+static bool is_scanned_header(string_view name)
+{
+  size_t dot = name.rfind('.');
+  string_view extension = dot == string_view::npos ? string_view() : name.substr(dot + 1);
+
+  return extension == "h" || extension == "hpp" || extension == "hxx";
+}
+
+// Looks at the directive starting at `i`, past the `#`. Includes may declare
+// symbols when the included file isn't scanned on its own, or when it got
+// included after a macro was given a value, as in the X-macro pattern.
+// Extensionless system headers, such as <vector>, are never scanned.
+static bool may_declare_through_directive(string_view source, size_t i, bool& defines_value)
+{
+  string_view directive = read_word(source, i);
+
+  if (directive == "define")
+  {
+    read_word(source, i);
+    if (i < source.size() && source[i] == '(')
+      defines_value = true;
+    while (i < source.size() && is_space(source[i]))
+      i++;
+    if (i < source.size() && source[i] != '\n' && source[i] != '\r' && source[i] != '/')
+      defines_value = true;
+  }
+  else if (directive == "include" || directive == "include_next" || directive == "import")
+  {
+    while (i < source.size() && is_space(source[i]))
+      i++;
+    if (i < source.size() && (source[i] == '"' || source[i] == '<'))
+    {
+      char closing = source[i] == '"' ? '"' : '>';
+      size_t end = source.find(closing, i + 1);
+      string_view name = source.substr(i + 1, end == string_view::npos ? string_view::npos : end - i - 1);
+
+      if (closing == '"')
+        return defines_value || !is_scanned_header(name);
+      return name.find('.') != string_view::npos && !is_scanned_header(name);
+    }
+    return true; // included through a macro
+  }
+  return false;
+}
+
+bool may_declare_symbols(string_view source)
+{
+  bool line_start = true;
+  bool defines_value = false;
+  size_t i = 0;
+
+  while (i < source.size())
+  {
+    char c = source[i];
+
+    if (c == '\n')
+    {
+      line_start = true;
+      i++;
+    }
+    else if (is_space(c))
+      i++;
+    else if (c == '/' && i + 1 < source.size() && source[i + 1] == '/')
+      i = skip_line(source, i);
+    else if (c == '/' && i + 1 < source.size() && source[i + 1] == '*')
+      i = skip_block_comment(source, i);
+    else if (c == '#' && line_start)
+    {
+      if (may_declare_through_directive(source, i + 1, defines_value))
+        return true;
+      i = skip_line(source, i);
+    }
+    else if (c == '"' || c == '\'')
+    {
+      i = skip_quoted(source, i);
+      line_start = false;
+    }
+    else if (is_identifier_char(c))
+    {
+      size_t start = i;
+      bool is_number = c >= '0' && c <= '9';
+      string_view word;
+
+      while (i < source.size() && (is_identifier_char(source[i]) || (is_number && source[i] == '\'')))
+        i++;
+      word = source.substr(start, i - start);
+      if (i < source.size() && source[i] == '"' && word.back() == 'R')
+        return true; // raw string literal
+      if (!is_number && find(declaration_keywords.begin(), declaration_keywords.end(), word) != declaration_keywords.end())
+        return true;
+      line_start = false;
+      // declarators may be split from their parameter list by newlines and comments
+      while (i < source.size())
+      {
+        if (is_space(source[i]))
+          i++;
+        else if (source[i] == '\n')
+        {
+          line_start = true;
+          i++;
+        }
+        else if (source[i] == '/' && i + 1 < source.size() && source[i + 1] == '/')
+        {
+          i = skip_line(source, i);
+          line_start = true;
+        }
+        else if (source[i] == '/' && i + 1 < source.size() && source[i + 1] == '*')
+          i = skip_block_comment(source, i);
+        else
+          break ;
+      }
+      if (!is_number && i < source.size() && source[i] == '(')
+        return true;
+    }
+    else
+    {
+      line_start = false;
+      i++;
+    }
+  }
+  return false;
+}
+
+#ifdef TWILI_HAS_MMAP
+bool may_declare_symbols(const filesystem::path& path)
+{
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat status;
+  bool result = true;
+
+  if (fd < 0)
+    return true;
+  if (fstat(fd, &status) == 0)
+  {
+    if (status.st_size == 0)
+      result = false;
+    else
+    {
+      void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+      if (data != MAP_FAILED)
+      {
+        madvise(data, status.st_size, MADV_SEQUENTIAL);
+        result = may_declare_symbols(string_view(static_cast<const char*>(data), status.st_size));
+        munmap(data, status.st_size);
+      }
+    }
+  }
+  close(fd);
+  return result;
+}
+#else
+bool may_declare_symbols(const filesystem::path& path)
+{
+  ifstream stream(path, ios::binary);
+  string source;
+
+  if (!stream)
+    return true;
+  source.assign(istreambuf_iterator<char>(stream), istreambuf_iterator<char>());
+  return may_declare_symbols(string_view(source));
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+#include <filesystem>
+#include <string_view>
+
+// Cheap lexical check run before handing a file to clang: returns false only
+// when the source has no declaration keyword (class, struct, union, enum,
+// namespace, typedef, using, template, operator) and no identifier followed
+// by a parenthesis outside of comments, strings and preprocessor directives.
+// Anything the scanner can't reason about (raw strings, unreadable files)
+// counts as a possible declaration, and so do includes of files which don't
+// get scanned on their own, or which follow a valued macro definition.
+bool may_declare_symbols(std::string_view source);
+bool may_declare_symbols(const std::filesystem::path&);
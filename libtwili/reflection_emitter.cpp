@@ -0,0 +1,354 @@
+#include "reflection_emitter.hpp"
+#include "scopetree.hpp"
+#include "output.hpp"
+#include <crails/utils/split.hpp>
+#include <sstream>
+#include <algorithm>
+#include <set>
+
+using namespace std;
+
+const string TwiliReflectionEmitter::support_header = "twili_reflection.hpp";
+
+static const char* support_header_source = R"(#pragma once
+#include <string_view>
+#include <optional>
+#include <array>
+#include <tuple>
+#include <cstddef>
+
+namespace twili
+{
+  template<typename T>
+  struct Reflection;
+
+  template<typename ENUM>
+  struct EnumEntry
+  {
+    std::string_view name;
+    ENUM             value;
+  };
+
+  template<typename POINTER>
+  struct MemberEntry
+  {
+    std::string_view name;
+    POINTER          pointer;
+  };
+
+  template<typename POINTER>
+  constexpr MemberEntry<POINTER> member(std::string_view name, POINTER pointer)
+  {
+    return {name, pointer};
+  }
+
+  template<typename ENUM>
+  constexpr std::optional<ENUM> enum_value(std::string_view name)
+  {
+    for (const auto& entry : Reflection<ENUM>::values)
+    {
+      if (entry.name == name)
+        return entry.value;
+    }
+    return {};
+  }
+
+  template<typename ENUM>
+  constexpr std::string_view enum_name(ENUM value)
+  {
+    for (const auto& entry : Reflection<ENUM>::values)
+    {
+      if (entry.value == value)
+        return entry.name;
+    }
+    return {};
+  }
+
+  template<typename T, typename VISITOR>
+  constexpr void each_field(VISITOR&& visitor)
+  {
+    std::apply([&visitor](const auto&... entries) { (visitor(entries), ...); }, Reflection<T>::fields);
+  }
+
+  template<typename T, typename VISITOR>
+  constexpr void each_method(VISITOR&& visitor)
+  {
+    std::apply([&visitor](const auto&... entries) { (visitor(entries), ...); }, Reflection<T>::methods);
+  }
+}
+)";
+
+struct ReflectionUnit
+{
+  vector<string>          includes;
+  vector<EnumDefinition>  enums;
+  vector<ClassDefinition> classes;
+};
+
+static string namespace_of(const TwiliScopeTree& tree, const ScopeNode* node)
+{
+  while (node && !tree.namespace_of(*node))
+    node = tree.parent_of(*node);
+  return node ? tree.namespace_of(*node)->full_name : string();
+}
+
+static filesystem::path path_for_namespace(const string& full_name)
+{
+  filesystem::path path;
+
+  for (const auto& part : Crails::split(full_name, ':'))
+    path /= part;
+  return path / "reflection.hpp";
+}
+
+static string include_for(const string& from_file, const vector<string>& directories)
+{
+  for (const string& directory : directories)
+  {
+    if (from_file.find(directory) == 0 && from_file.length() > directory.length())
+      return filesystem::path(from_file).lexically_relative(directory).generic_string();
+  }
+  return from_file;
+}
+
+// Types declared within classes can only be named when they are public,
+// and none of their enclosing classes is a template: members using other
+// nested types are left out.
+struct NameableTypes
+{
+  const TwiliScopeTree& tree;
+  set<string>           reflected;
+
+  NameableTypes(const TwiliScopeTree& tree) : tree(tree) {}
+
+  bool is_class_scope(const string& full_name) const
+  {
+    const ScopeNode* node = tree.find(full_name);
+
+    return node && node->kind == ScopeNode::ClassNode;
+  }
+
+  bool has_nameable_scope(const string& full_name) const
+  {
+    string scope = scope_of(full_name);
+
+    return !is_class_scope(scope) || reflected.count(scope) > 0;
+  }
+
+  // Types spelled as `...` couldn't be rendered by libclang.
+  bool accepts(const string& type) const
+  {
+    if (type.find("...") != string::npos)
+      return false;
+    for (const string& name : type_names_in(type))
+    {
+      if (is_class_scope(scope_of(name)) && reflected.count(name) == 0)
+        return false;
+    }
+    return true;
+  }
+};
+
+static bool is_reflectable(const InvokableDefinition& invokable, const NameableTypes& types)
+{
+  if (invokable.is_template())
+    return false;
+  if (invokable.return_type && (invokable.return_type->is_symbolic || !types.accepts(invokable.return_type->to_string())))
+    return false;
+  for (const auto& param : invokable.params)
+  {
+    if (param.is_symbolic || !types.accepts(param.to_string()))
+      return false;
+  }
+  return true;
+}
+
+static string method_pointer_type(const ClassDefinition& klass, const MethodDefinition& method)
+{
+  stringstream stream;
+
+  stream << (method.return_type ? method.return_type->to_string() : string("void"));
+  if (method.is_static)
+    stream << " (*)(";
+  else
+    stream << " (" << klass.full_name << "::*)(";
+  for (size_t i = 0 ; i < method.params.size() ; ++i)
+    stream << (i > 0 ? ", " : "") << method.params[i].to_string();
+  if (method.is_variadic)
+    stream << (method.params.size() > 0 ? ", ..." : "...");
+  stream << ')';
+  if (method.is_const)
+    stream << " const";
+  if (method.ref_qualifier == CXRefQualifier_LValue)
+    stream << " &";
+  else if (method.ref_qualifier == CXRefQualifier_RValue)
+    stream << " &&";
+  if (method.is_noexcept().value_or(false)) // potentially throwing pointers still accept noexcept methods
+    stream << " noexcept";
+  return stream.str();
+}
+
+static void render_enum(stringstream& stream, const EnumDefinition& definition)
+{
+  stream << "  template<>\n"
+         << "  struct Reflection<" << definition.full_name << ">\n"
+         << "  {\n"
+         << "    static constexpr std::string_view name = \"" << definition.full_name << "\";\n"
+         << "    static constexpr std::array<EnumEntry<" << definition.full_name << ">, " << definition.flags.size() << "> values{{\n";
+  for (const auto& flag : definition.flags)
+    stream << "      {\"" << flag.first << "\", " << definition.full_name << "::" << flag.first << "},\n";
+  stream << "    }};\n"
+         << "  };\n\n";
+}
+
+static void render_class(stringstream& stream, const ClassDefinition& klass, const NameableTypes& types)
+{
+  bool first;
+
+  stream << "  template<>\n"
+         << "  struct Reflection<" << klass.full_name << ">\n"
+         << "  {\n"
+         << "    static constexpr std::string_view name = \"" << klass.full_name << "\";\n"
+         << "    static constexpr auto fields = std::make_tuple(";
+  first = true;
+  for (const auto& field : klass.fields)
+  {
+    // pointers to members can't designate references or bit-fields
+    if (field.visibility != "public" || field.is_symbolic || field.is_reference || field.layout.is_bit_field() || !types.accepts(field.to_string()))
+      continue ;
+    stream << (first ? "\n" : ",\n")
+           << "      member(\"" << field.name << "\", &" << klass.full_name << "::" << field.name << ')';
+    first = false;
+  }
+  stream << ");\n"
+         << "    static constexpr auto methods = std::make_tuple(";
+  first = true;
+  for (const auto& method : klass.methods)
+  {
+    if (method.visibility != "public" || method.is_deleted || !is_reflectable(method, types))
+      continue ;
+    stream << (first ? "\n" : ",\n")
+           << "      member(\"" << method.name << "\", static_cast<" << method_pointer_type(klass, method) << ">(&"
+           << klass.full_name << "::" << method.name << "))";
+    first = false;
+  }
+  stream << ");\n"
+         << "  };\n\n";
+}
+
+static string render_unit(const filesystem::path& path, const ReflectionUnit& unit, const NameableTypes& types)
+{
+  stringstream stream;
+  filesystem::path support_path = filesystem::path(TwiliReflectionEmitter::support_header).lexically_relative(path.parent_path());
+
+  stream << "#pragma once\n"
+         << "#include \"" << support_path.generic_string() << "\"\n";
+  for (const string& include : unit.includes)
+    stream << "#include \"" << include << "\"\n";
+  stream << "\nnamespace twili\n{\n";
+  for (const auto& definition : unit.enums)
+    render_enum(stream, definition);
+  for (const auto& klass : unit.classes)
+    render_class(stream, klass, types);
+  stream << "}\n";
+  return stream.str();
+}
+
+map<filesystem::path, string> TwiliReflectionEmitter::render() const
+{
+  map<string, ReflectionUnit> units;
+  map<filesystem::path, string> files;
+  TwiliScopeTree tree(parser);
+  NameableTypes types(tree);
+  vector<ClassDefinition> classes = parser.get_classes();
+  vector<ClassDefinition> enclosing_first = classes;
+  vector<EnumDefinition> enums = parser.get_enums();
+  auto add_include = [&](ReflectionUnit& unit, const string& from_file)
+  {
+    string include = include_for(from_file, parser.get_directories());
+
+    if (find(unit.includes.begin(), unit.includes.end(), include) == unit.includes.end())
+      unit.includes.push_back(include);
+  };
+
+  // enclosing classes have shorter names, and get checked first
+  stable_sort(enclosing_first.begin(), enclosing_first.end(), [](const ClassDefinition& a, const ClassDefinition& b)
+  {
+    return a.full_name.length() < b.full_name.length();
+  });
+  for (const auto& klass : enclosing_first)
+  {
+    if (!klass.is_template() && klass.from_file.length() > 0 && types.has_nameable_scope(klass.full_name))
+      types.reflected.insert(klass.full_name);
+  }
+  for (const auto& definition : enums)
+  {
+    if (definition.name.length() > 0 && definition.visibility == "public" && types.has_nameable_scope(definition.full_name))
+      types.reflected.insert(definition.full_name);
+  }
+  for (const auto& definition : enums)
+  {
+    if (types.reflected.count(definition.full_name) == 0)
+      continue ;
+    ReflectionUnit& unit = units[namespace_of(tree, tree.find(scope_of(definition.full_name)))];
+
+    add_include(unit, definition.from_file);
+    unit.enums.push_back(definition);
+  }
+  for (const auto& klass : classes)
+  {
+    if (types.reflected.count(klass.full_name) == 0)
+      continue ;
+    ReflectionUnit& unit = units[namespace_of(tree, tree.find(klass.full_name))];
+
+    add_include(unit, klass.from_file);
+    unit.classes.push_back(klass);
+  }
+  files.emplace(support_header, support_header_source);
+  for (const auto& entry : units)
+  {
+    filesystem::path path = path_for_namespace(entry.first);
+
+    files.emplace(path, render_unit(path, entry.second, types));
+  }
+  return files;
+}
+
+// Headers left over from namespaces which are gone from the model.
+static void remove_stale_headers(const filesystem::path& output_directory, const map<filesystem::path, string>& files)
+{
+  vector<filesystem::path> stale;
+  error_code error;
+
+  if (!filesystem::is_directory(output_directory))
+    return ;
+  for (const auto& entry : filesystem::recursive_directory_iterator(output_directory))
+  {
+    filesystem::path path = entry.path().lexically_relative(output_directory);
+
+    if (entry.is_regular_file() && path.filename() == "reflection.hpp" && files.find(path) == files.end())
+      stale.push_back(entry.path());
+  }
+  for (const auto& path : stale)
+  {
+    filesystem::remove(path);
+    for (auto directory = path.parent_path() ; directory != output_directory && filesystem::is_empty(directory, error) ; directory = directory.parent_path())
+      filesystem::remove(directory, error);
+  }
+}
+
+vector<filesystem::path> TwiliReflectionEmitter::write(const filesystem::path& output_directory) const
+{
+  vector<filesystem::path> written;
+  map<filesystem::path, string> files = render();
+
+  for (const auto& file : files)
+  {
+    filesystem::path path = output_directory / file.first;
+
+    if (write_if_changed(path, file.second))
+      written.push_back(path);
+  }
+  remove_stale_headers(output_directory, files);
+  return written;
+}
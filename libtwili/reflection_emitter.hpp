@@ -0,0 +1,23 @@
+#pragma once
+#include "parser.hpp"
+#include <filesystem>
+#include <map>
+
+// Renders the model as C++ headers of constexpr tables: one header for each
+// namespace, specializing twili::Reflection<T> for its enums and classes,
+// plus the twili_reflection.hpp header which defines the table types.
+// Only public, non-template members with resolved types are reflected.
+class TwiliReflectionEmitter
+{
+  const TwiliParser& parser;
+public:
+  static const std::string support_header;
+
+  TwiliReflectionEmitter(const TwiliParser& parser) : parser(parser) {}
+
+  std::map<std::filesystem::path, std::string> render() const;
+
+  // Only writes the files which contents changed, and returns their paths.
+  // Namespace headers which are no longer rendered get removed.
+  std::vector<std::filesystem::path> write(const std::filesystem::path& output_directory) const;
+};
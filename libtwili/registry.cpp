@@ -0,0 +1,26 @@
+#include "registry.hpp"
+
+using namespace std;
+
+string TwiliSharedRegistry::key_for(const TypeDefinition& type)
+{
+  string key = type.raw_name + '\n' + type.name + '\n' + type.type_full_name + '\n';
+
+  for (const string& scope : type.scopes)
+    key += "::" + scope;
+  return key;
+}
+
+bool TwiliSharedRegistry::add_type(const TypeDefinition& type)
+{
+  return types.insert(key_for(type), type).second;
+}
+
+vector<TypeDefinition> TwiliSharedRegistry::get_types() const
+{
+  vector<TypeDefinition> result;
+
+  for (const TypeDefinition* type : types.values())
+    result.push_back(*type);
+  return result;
+}
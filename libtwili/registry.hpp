@@ -0,0 +1,146 @@
+#pragma once
+#include "definitions.hpp"
+#include "hash.hpp"
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+// Append-only hash map which several threads can fill and read at once,
+// without locks: each bucket is a singly linked list, new nodes get pushed
+// at its head with a compare-and-swap, and published nodes are never
+// modified nor freed before the registry itself. Lookups never block, and
+// when threads insert the same key, exactly one of them wins.
+// The bucket count is fixed, so it should be sized for the expected number
+// of entries.
+template<typename VALUE>
+class TwiliConcurrentRegistry
+{
+  struct Node
+  {
+    std::string key;
+    TwiliHash   hash;
+    std::size_t sequence;
+    VALUE       value;
+    Node*       next;
+  };
+
+  std::unique_ptr<std::atomic<Node*>[]> buckets;
+  std::size_t                           bucket_mask;
+  std::atomic<std::size_t>              sequence{0};
+  std::atomic<std::size_t>              count{0};
+
+  static const Node* find_in(const Node* node, const Node* end, const std::string& key, TwiliHash hash)
+  {
+    for (; node != end ; node = node->next)
+    {
+      if (node->hash == hash && node->key == key)
+        return node;
+    }
+    return nullptr;
+  }
+
+public:
+  explicit TwiliConcurrentRegistry(std::size_t bucket_count = 4096)
+  {
+    std::size_t size = 1;
+
+    while (size < bucket_count)
+      size <<= 1;
+    buckets.reset(new std::atomic<Node*>[size]);
+    for (std::size_t i = 0 ; i < size ; ++i)
+      buckets[i].store(nullptr, std::memory_order_relaxed);
+    bucket_mask = size - 1;
+  }
+
+  TwiliConcurrentRegistry(const TwiliConcurrentRegistry&) = delete;
+  TwiliConcurrentRegistry& operator=(const TwiliConcurrentRegistry&) = delete;
+
+  ~TwiliConcurrentRegistry()
+  {
+    for (std::size_t i = 0 ; i <= bucket_mask ; ++i)
+    {
+      Node* node = buckets[i].load(std::memory_order_relaxed);
+
+      while (node)
+      {
+        Node* next = node->next;
+
+        delete node;
+        node = next;
+      }
+    }
+  }
+
+  // Returns the value stored for `key`, and whether this call inserted it.
+  std::pair<const VALUE*, bool> insert(const std::string& key, VALUE value)
+  {
+    TwiliHash hash = twili_hash(key);
+    std::atomic<Node*>& bucket = buckets[hash & bucket_mask];
+    Node* head = bucket.load(std::memory_order_acquire);
+    const Node* scanned_until = nullptr;
+    std::unique_ptr<Node> node;
+
+    for (;;)
+    {
+      // lists only grow at their head: after a failed swap, only the
+      // nodes pushed in the meantime need to be checked
+      if (const Node* existing = find_in(head, scanned_until, key, hash))
+        return {&existing->value, false};
+      if (!node)
+        node.reset(new Node{key, hash, sequence.fetch_add(1, std::memory_order_relaxed), std::move(value), nullptr});
+      node->next = head;
+      scanned_until = head;
+      if (bucket.compare_exchange_weak(head, node.get(), std::memory_order_release, std::memory_order_acquire))
+      {
+        count.fetch_add(1, std::memory_order_relaxed);
+        return {&node.release()->value, true};
+      }
+    }
+  }
+
+  const VALUE* find(const std::string& key) const
+  {
+    TwiliHash hash = twili_hash(key);
+    const Node* node = find_in(buckets[hash & bucket_mask].load(std::memory_order_acquire), nullptr, key, hash);
+
+    return node ? &node->value : nullptr;
+  }
+
+  std::size_t size() const { return count.load(std::memory_order_relaxed); }
+
+  // Values published so far, in the order their insertion started.
+  std::vector<const VALUE*> values() const
+  {
+    std::vector<const Node*> nodes;
+    std::vector<const VALUE*> result;
+
+    nodes.reserve(size());
+    for (std::size_t i = 0 ; i <= bucket_mask ; ++i)
+    {
+      for (const Node* node = buckets[i].load(std::memory_order_acquire) ; node ; node = node->next)
+        nodes.push_back(node);
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const Node* a, const Node* b) { return a->sequence < b->sequence; });
+    result.reserve(nodes.size());
+    for (const Node* node : nodes)
+      result.push_back(&node->value);
+    return result;
+  }
+};
+
+class TwiliParser;
+
+// Shared by parsers visiting translation units concurrently: types are keyed
+// by their spelling and resolved name, classes by their full name, mapped to
+// the parser which claimed their definition.
+struct TwiliSharedRegistry
+{
+  TwiliConcurrentRegistry<TypeDefinition>     types;
+  TwiliConcurrentRegistry<const TwiliParser*> classes;
+
+  explicit TwiliSharedRegistry(std::size_t bucket_count = 65536) : types(bucket_count), classes(bucket_count) {}
+
+  static std::string key_for(const TypeDefinition&);
+  bool                        add_type(const TypeDefinition&);
+  std::vector<TypeDefinition> get_types() const;
+};
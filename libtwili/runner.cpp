@@ -1,4 +1,6 @@
 #include "runner.hpp"
+#include "prefilter.hpp"
+#include "output.hpp"
 #include <regex>
 #include <iostream>
 
@@ -19,6 +21,15 @@ static void collect_files(const filesystem::path& path, vector<filesystem::path>
     files.push_back(path);
 }
 
+vector<filesystem::path> probe_files(const TwiliParser& parser)
+{
+  vector<filesystem::path> files;
+
+  for (const string& dirpath : parser.get_directories())
+    collect_files(filesystem::path(dirpath), files);
+  return files;
+}
+
 bool probe_and_run_parser(TwiliParser& parser, int argc, const char** argv, vector<filesystem::path>& files)
 {
   for (const string& dirpath : parser.get_directories())
@@ -37,25 +48,152 @@ bool probe_and_run_parser(TwiliParser& parser, int argc, const char** argv)
 
 bool run_parser(TwiliParser& parser, const vector<filesystem::path>& files, int argc, const char** argv)
 {
+  return run_parser(parser, files, TwiliRunOptions(), argc, argv).success();
+}
+
+TwiliRunReport probe_and_run_parser(TwiliParser& parser, const TwiliRunOptions& options, int argc, const char** argv)
+{
+  return run_parser(parser, probe_files(parser), options, argc, argv);
+}
+
+static int abort_indexing(CXClientData data, void*)
+{
+  TwiliScanMonitor* monitor = reinterpret_cast<TwiliParser*>(data)->get_monitor();
+
+  return monitor && monitor->cancelled.load(memory_order_relaxed);
+}
+
+static void index_declaration(CXClientData data, const CXIdxDeclInfo* declaration)
+{
+  reinterpret_cast<TwiliParser*>(data)->visit_indexed_declaration(declaration);
+}
+
+static IndexerCallbacks indexer_callbacks = {
+  &abort_indexing, nullptr, nullptr, nullptr, nullptr, nullptr, &index_declaration, nullptr
+};
+
+static void print_failure(const TwiliFileReport& report)
+{
+  cerr << "\r/!\\ Failed to parse file " << report.path << endl;
+  for (const auto& diagnostic : report.diagnostics)
+  {
+    if (diagnostic.is_error())
+      cerr << diagnostic.to_string() << endl;
+  }
+}
+
+TwiliRunReport run_parser(TwiliParser& parser, const vector<filesystem::path>& files, const TwiliRunOptions& options, int argc, const char** argv)
+{
+  return run_parser(parser, files, TwiliVirtualFiles(), options, argc, argv);
+}
+
+TwiliRunReport run_parser(TwiliParser& parser, const TwiliVirtualFiles& virtual_files, const TwiliRunOptions& options, int argc, const char** argv)
+{
+  vector<filesystem::path> files;
+
+  for (const auto& entry : virtual_files)
+    files.push_back(entry.first);
+  return run_parser(parser, files, virtual_files, options, argc, argv);
+}
+
+TwiliRunReport run_parser(TwiliParser& parser, const vector<filesystem::path>& files, const TwiliVirtualFiles& virtual_files, const TwiliRunOptions& options, int argc, const char** argv)
+{
+  TwiliRunReport report;
+  vector<string> unsaved_paths;
+  vector<CXUnsavedFile> unsaved_files;
+  CXIndex index = clang_createIndex(0, 0);
+  CXIndexAction index_action = options.indexer ? clang_IndexAction_create(index) : nullptr;
+  unsigned int flags = options.translation_unit_flags | parser.translation_unit_flags();
+  TwiliScanMonitor* monitor = parser.get_monitor();
+  bool record_inclusions = options.record_inclusions || !options.depfile_path.empty();
+
+  if (options.keep_going || options.single_file)
+    flags |= CXTranslationUnit_KeepGoing;
+  if (options.single_file)
+    flags |= CXTranslationUnit_SingleFileParse | CXTranslationUnit_SkipFunctionBodies;
+  if (monitor)
+    monitor->files_total.store(files.size(), memory_order_relaxed);
+  unsaved_paths.reserve(virtual_files.size());
+  for (const auto& entry : virtual_files)
+  {
+    unsaved_paths.push_back(filesystem::weakly_canonical(entry.first).string());
+    unsaved_files.push_back({unsaved_paths.back().c_str(), entry.second.data(), static_cast<unsigned long>(entry.second.size())});
+  }
   for (const auto& filepath : files)
   {
-    CXIndex index = clang_createIndex(0, 0);
-    CXTranslationUnit unit = clang_parseTranslationUnit(
-      index,
-      filepath.string().c_str(),
-      argv, argc,
-      nullptr, 0,
-      CXTranslationUnit_None
-    );
-
-    cout << "\r- Importing " << filepath.string() << endl;
-    if (unit == nullptr || !parser(unit))
+    if (monitor && monitor->cancelled.load(memory_order_relaxed))
+      break ;
+    TwiliFileReport& file_report = report.files.emplace_back();
+    CXTranslationUnit unit = nullptr;
+    auto virtual_file = virtual_files.find(filepath);
+    bool is_virtual = virtual_file != virtual_files.end();
+
+    file_report.path = is_virtual ? filesystem::weakly_canonical(filepath).string() : filepath.string();
+    file_report.errors_expected = options.single_file;
+    if (options.prefilter && !(is_virtual ? may_declare_symbols(virtual_file->second) : may_declare_symbols(filepath)))
+    {
+      file_report.skipped = true;
+      if (monitor)
+        monitor->files_done.fetch_add(1, memory_order_relaxed);
+      continue ;
+    }
+    if (options.verbose)
+      cout << "\r- Importing " << file_report.path << endl;
+    if (index_action)
+    {
+      file_report.error_code = static_cast<CXErrorCode>(clang_indexSourceFile(
+        index_action,
+        &parser, &indexer_callbacks, sizeof(indexer_callbacks),
+        CXIndexOpt_SkipParsedBodiesInSession,
+        file_report.path.c_str(),
+        argv, argc,
+        unsaved_files.data(), unsaved_files.size(),
+        &unit,
+        flags
+      ));
+    }
+    else
+    {
+      file_report.error_code = clang_parseTranslationUnit2(
+        index,
+        file_report.path.c_str(),
+        argv, argc,
+        unsaved_files.data(), unsaved_files.size(),
+        flags,
+        &unit
+      );
+    }
+    if (unit)
+    {
+      file_report.parsed = true;
+      if (index_action)
+        parser.end_unit(unit);
+      else
+        parser.visit(unit);
+      if (record_inclusions)
+        parser.record_inclusions(unit);
+      collect_diagnostics(unit, file_report, options.diagnostic_severity);
+      clang_disposeTranslationUnit(unit);
+    }
+    if (monitor)
+      monitor->files_done.fetch_add(1, memory_order_relaxed);
+    if (file_report.has_failed())
     {
-      cerr << "\r/!\\ Failed to parse file " << filepath.string() << endl;
-      return false;
+      if (options.verbose)
+        print_failure(file_report);
+      if (!options.keep_going)
+        break ;
     }
-    clang_disposeTranslationUnit(unit);
-    clang_disposeIndex(index);
   }
-  return true;
+  if (index_action)
+    clang_IndexAction_dispose(index_action);
+  clang_disposeIndex(index);
+  report.cancelled = monitor && monitor->cancelled.load(memory_order_relaxed);
+  if (options.resolve_types && !report.cancelled)
+    report.unresolved_types = parser.resolve_types();
+  if (options.verbose && ((options.keep_going && !report.success()) || report.unresolved_types.size() > 0))
+    cerr << '\r' << report.summary() << endl;
+  if (!report.cancelled)
+    write_run_outputs(parser, report, options);
+  return report;
 }
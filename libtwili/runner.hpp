@@ -1,8 +1,39 @@
 #pragma once
 #include "parser.hpp"
+#include "diagnostics.hpp"
 #include <filesystem>
 #include <vector>
+#include <map>
+#include <string_view>
+
+struct TwiliRunOptions
+{
+  bool                 keep_going = false;
+  unsigned int         translation_unit_flags = CXTranslationUnit_None;
+  CXDiagnosticSeverity diagnostic_severity = CXDiagnostic_Warning;
+  bool                 resolve_types = true; // runs the deferred type resolution once all files are visited
+  bool                 single_file = false; // parses each file without expanding its includes
+  bool                 verbose = true; // reports progress and failures on the standard outputs
+  bool                 prefilter = false; // skips files in which may_declare_symbols finds nothing
+  bool                 indexer = false; // goes through clang_indexSourceFile, skipping bodies already parsed during the run
+  bool                 record_inclusions = false; // records the include graph, at any detail level
+  std::filesystem::path output_path; // serialized model, only rewritten when it changes
+  std::filesystem::path depfile_path; // lists the files the model depends on, implies record_inclusions
+};
+
+std::vector<std::filesystem::path> probe_files(const TwiliParser&);
 
 bool probe_and_run_parser(TwiliParser&, int argc, const char** argv, std::vector<std::filesystem::path>&);
 bool probe_and_run_parser(TwiliParser&, int argc = 0, const char** argv = nullptr);
 bool run_parser(TwiliParser&, const std::vector<std::filesystem::path>&, int argc = 0, const char** argv = nullptr);
+
+TwiliRunReport probe_and_run_parser(TwiliParser&, const TwiliRunOptions&, int argc = 0, const char** argv = nullptr);
+TwiliRunReport run_parser(TwiliParser&, const std::vector<std::filesystem::path>&, const TwiliRunOptions&, int argc = 0, const char** argv = nullptr);
+
+// In-memory sources, passed to clang as unsaved files: they take precedence
+// over the files on disk, and can be included from other files. The buffers
+// must stay alive until the run is over.
+typedef std::map<std::filesystem::path, std::string_view> TwiliVirtualFiles;
+
+TwiliRunReport run_parser(TwiliParser&, const std::vector<std::filesystem::path>&, const TwiliVirtualFiles&, const TwiliRunOptions&, int argc = 0, const char** argv = nullptr);
+TwiliRunReport run_parser(TwiliParser&, const TwiliVirtualFiles&, const TwiliRunOptions&, int argc = 0, const char** argv = nullptr);
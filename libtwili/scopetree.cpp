@@ -0,0 +1,227 @@
+#include "scopetree.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+struct ScopeBuilder
+{
+  struct Node
+  {
+    ScopeNode::Kind kind = ScopeNode::NamespaceNode;
+    string_view     name;
+    size_t          definition = ScopeNode::npos;
+    size_t          parent = ScopeNode::npos;
+    vector<size_t>  children;
+    vector<size_t>  enums;
+    vector<size_t>  functions;
+  };
+
+  vector<Node>                  nodes = vector<Node>(1);
+  unordered_map<string, size_t> indexes;
+
+  size_t node_for(const vector<string_view>& scopes, size_t count)
+  {
+    size_t index = 0;
+    string path;
+
+    for (size_t i = 0 ; i < count ; ++i)
+    {
+      path += "::";
+      path += scopes[i];
+      auto it = indexes.find(path);
+
+      if (it == indexes.end())
+      {
+        Node& node = nodes.emplace_back();
+
+        node.name = scopes[i];
+        node.parent = index;
+        nodes[index].children.push_back(nodes.size() - 1);
+        it = indexes.emplace(path, nodes.size() - 1).first;
+      }
+      index = it->second;
+    }
+    return index;
+  }
+
+  size_t node_for(const string& full_name)
+  {
+    auto scopes = split_scopes(full_name);
+
+    return node_for(scopes, scopes.size());
+  }
+
+  size_t parent_node_for(const string& full_name)
+  {
+    auto scopes = split_scopes(full_name);
+
+    return node_for(scopes, scopes.size() > 0 ? scopes.size() - 1 : 0);
+  }
+};
+
+vector<string_view> split_scopes(string_view full_name)
+{
+  vector<string_view> scopes;
+  size_t start = 0;
+  int depth = 0;
+
+  for (size_t i = 0 ; i < full_name.length() ; ++i)
+  {
+    char c = full_name[i];
+
+    if (c == '<' || c == '(')
+      depth++;
+    else if ((c == '>' || c == ')') && depth > 0)
+      depth--;
+    else if (c == ':' && depth == 0 && i + 1 < full_name.length() && full_name[i + 1] == ':')
+    {
+      if (i > start)
+        scopes.push_back(full_name.substr(start, i - start));
+      start = ++i + 1;
+    }
+  }
+  if (start < full_name.length())
+    scopes.push_back(full_name.substr(start));
+  return scopes;
+}
+
+TwiliScopeTree::TwiliScopeTree(const TwiliParser& parser) : namespaces(parser.get_namespaces()), classes(parser.get_classes())
+{
+  const vector<EnumDefinition> parsed_enums = parser.get_enums();
+  const vector<FunctionDefinition>& parsed_functions = parser.get_functions();
+  ScopeBuilder builder;
+  vector<size_t> order{0};
+  vector<size_t> new_indexes(1, 0);
+
+  for (size_t i = 0 ; i < namespaces.size() ; ++i)
+    builder.nodes[builder.node_for(namespaces[i].full_name)].definition = i;
+  for (size_t i = 0 ; i < classes.size() ; ++i)
+  {
+    ScopeBuilder::Node& node = builder.nodes[builder.node_for(classes[i].full_name)];
+
+    node.kind = ScopeNode::ClassNode;
+    node.definition = i;
+  }
+  for (size_t i = 0 ; i < parsed_enums.size() ; ++i)
+    builder.nodes[builder.parent_node_for(parsed_enums[i].full_name)].enums.push_back(i);
+  for (size_t i = 0 ; i < parsed_functions.size() ; ++i)
+    builder.nodes[builder.parent_node_for(parsed_functions[i].full_name)].functions.push_back(i);
+  new_indexes.resize(builder.nodes.size());
+  for (size_t i = 0 ; i < order.size() ; ++i)
+  {
+    auto& children = builder.nodes[order[i]].children;
+
+    sort(children.begin(), children.end(), [&builder](size_t a, size_t b) { return builder.nodes[a].name < builder.nodes[b].name; });
+    for (size_t child : children)
+    {
+      new_indexes[child] = order.size();
+      order.push_back(child);
+    }
+  }
+  nodes.resize(order.size());
+  for (size_t i = 0 ; i < order.size() ; ++i)
+  {
+    const ScopeBuilder::Node& source = builder.nodes[order[i]];
+    ScopeNode& node = nodes[i];
+
+    node.kind = source.kind;
+    node.name = string(source.name);
+    node.definition = source.definition;
+    if (source.parent != ScopeNode::npos)
+    {
+      node.parent = new_indexes[source.parent];
+      node.depth = nodes[node.parent].depth + 1;
+    }
+    node.first_child = source.children.size() > 0 ? new_indexes[source.children.front()] : 0;
+    node.child_count = source.children.size();
+    node.first_enum = enums.size();
+    node.enum_count = source.enums.size();
+    for (size_t index : source.enums)
+      enums.push_back(parsed_enums[index]);
+    node.first_function = functions.size();
+    node.function_count = source.functions.size();
+    for (size_t index : source.functions)
+      functions.push_back(parsed_functions[index]);
+  }
+}
+
+const ScopeNode* TwiliScopeTree::parent_of(const ScopeNode& node) const
+{
+  return node.is_root() ? nullptr : &nodes[node.parent];
+}
+
+const ScopeNode* TwiliScopeTree::enclosing_namespace(const ScopeNode& node) const
+{
+  const ScopeNode* parent = parent_of(node);
+
+  while (parent && parent->kind != ScopeNode::NamespaceNode)
+    parent = parent_of(*parent);
+  return parent;
+}
+
+ScopeRange<ScopeNode> TwiliScopeTree::children_of(const ScopeNode& node) const
+{
+  const ScopeNode* first = nodes.data() + node.first_child;
+
+  return {first, first + node.child_count};
+}
+
+ScopeRange<EnumDefinition> TwiliScopeTree::enums_in(const ScopeNode& node) const
+{
+  const EnumDefinition* first = enums.data() + node.first_enum;
+
+  return {first, first + node.enum_count};
+}
+
+ScopeRange<FunctionDefinition> TwiliScopeTree::functions_in(const ScopeNode& node) const
+{
+  const FunctionDefinition* first = functions.data() + node.first_function;
+
+  return {first, first + node.function_count};
+}
+
+const NamespaceDefinition* TwiliScopeTree::namespace_of(const ScopeNode& node) const
+{
+  return node.kind == ScopeNode::NamespaceNode && node.is_declared() ? &namespaces[node.definition] : nullptr;
+}
+
+const ClassDefinition* TwiliScopeTree::class_of(const ScopeNode& node) const
+{
+  return node.kind == ScopeNode::ClassNode && node.is_declared() ? &classes[node.definition] : nullptr;
+}
+
+const ScopeNode* TwiliScopeTree::find_child(const ScopeNode& node, string_view name) const
+{
+  auto children = children_of(node);
+  auto it = lower_bound(children.begin(), children.end(), name, [](const ScopeNode& child, string_view value) { return child.name < value; });
+
+  return it != children.end() && it->name == name ? it : nullptr;
+}
+
+const ScopeNode* TwiliScopeTree::find(string_view full_name) const
+{
+  const ScopeNode* node = &root();
+
+  for (string_view scope : split_scopes(full_name))
+  {
+    node = find_child(*node, scope);
+    if (!node)
+      break ;
+  }
+  return node;
+}
+
+string TwiliScopeTree::qualified_name(const ScopeNode& node) const
+{
+  vector<const ScopeNode*> path;
+  string result;
+
+  for (const ScopeNode* it = &node ; !it->is_root() ; it = &nodes[it->parent])
+    path.push_back(it);
+  if (path.empty())
+    return "::";
+  for (auto it = path.rbegin() ; it != path.rend() ; ++it)
+    result += "::" + (*it)->name;
+  return result;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "parser.hpp"
+#include <string_view>
+
+struct ScopeNode
+{
+  static const std::size_t npos = static_cast<std::size_t>(-1);
+
+  enum Kind
+  {
+    NamespaceNode,
+    ClassNode
+  };
+
+  Kind        kind = NamespaceNode;
+  std::string name;
+  std::size_t definition = npos; // index in namespaces or classes, npos for undeclared scopes
+  std::size_t parent = npos;
+  std::size_t depth = 0;
+  std::size_t first_child = 0;
+  std::size_t child_count = 0;
+  std::size_t first_enum = 0;
+  std::size_t enum_count = 0;
+  std::size_t first_function = 0;
+  std::size_t function_count = 0;
+
+  bool is_root() const { return parent == npos; }
+  bool is_declared() const { return definition != npos; }
+};
+
+template<typename T>
+struct ScopeRange
+{
+  const T* first;
+  const T* last;
+  const T* begin() const { return first; }
+  const T* end() const { return last; }
+  std::size_t size() const { return last - first; }
+};
+
+// Scope hierarchy of a parsed model, built once. Nodes are stored breadth
+// first, so that the children of a node are contiguous and sorted by name,
+// and enums and functions are stored grouped by the scope declaring them.
+// Scopes which only appear as part of a full name, such as namespaces left
+// out by the filter, get undeclared namespace nodes.
+class TwiliScopeTree
+{
+  std::vector<ScopeNode>           nodes;
+  std::vector<NamespaceDefinition> namespaces;
+  std::vector<ClassDefinition>     classes;
+  std::vector<EnumDefinition>      enums;
+  std::vector<FunctionDefinition>  functions;
+public:
+  TwiliScopeTree(const TwiliParser&);
+
+  const std::vector<ScopeNode>& get_nodes() const { return nodes; }
+  const ScopeNode&              root() const { return nodes.front(); }
+  const ScopeNode*              parent_of(const ScopeNode&) const;
+  const ScopeNode*              enclosing_namespace(const ScopeNode&) const;
+  ScopeRange<ScopeNode>         children_of(const ScopeNode&) const;
+  ScopeRange<EnumDefinition>    enums_in(const ScopeNode&) const;
+  ScopeRange<FunctionDefinition> functions_in(const ScopeNode&) const;
+  const NamespaceDefinition*    namespace_of(const ScopeNode&) const;
+  const ClassDefinition*        class_of(const ScopeNode&) const;
+
+  const ScopeNode* find_child(const ScopeNode&, std::string_view name) const;
+  const ScopeNode* find(std::string_view full_name) const;
+  std::string      qualified_name(const ScopeNode&) const;
+};
+
+// Splits a full name such as `::a::B<::c::D>` into `a` and `B<::c::D>`.
+std::vector<std::string_view> split_scopes(std::string_view full_name);
@@ -0,0 +1,471 @@
+#include "serializer.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+static const string_view model_header("TWILI8");
+
+void TwiliWriter::write_number(uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    buffer += static_cast<char>((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+  buffer += static_cast<char>(value);
+}
+
+void TwiliWriter::write_signed(int64_t value)
+{
+  write_number((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void TwiliWriter::write_string(string_view value)
+{
+  write_number(value.size());
+  buffer.append(value);
+}
+
+uint64_t TwiliReader::read_number()
+{
+  uint64_t value = 0;
+
+  for (int shift = 0 ; shift < 64 ; shift += 7)
+  {
+    unsigned char byte;
+
+    if (at_end())
+      throw runtime_error("TwiliReader: unexpected end of data");
+    byte = static_cast<unsigned char>(data[position++]);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0)
+      return value;
+  }
+  throw runtime_error("TwiliReader: malformed number");
+}
+
+int64_t TwiliReader::read_signed()
+{
+  uint64_t value = read_number();
+
+  return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+bool TwiliReader::read_flag()
+{
+  if (at_end())
+    throw runtime_error("TwiliReader: unexpected end of data");
+  return data[position++] != 0;
+}
+
+string TwiliReader::read_string()
+{
+  uint64_t length = read_number();
+  string result;
+
+  if (length > data.size() - position)
+    throw runtime_error("TwiliReader: unexpected end of data");
+  result = data.substr(position, length);
+  position += length;
+  return result;
+}
+
+template<typename T>
+static void write_list(TwiliWriter& writer, const T& list, void (*write_item)(TwiliWriter&, const typename T::value_type&))
+{
+  writer.write_number(list.size());
+  for (const auto& item : list)
+    write_item(writer, item);
+}
+
+template<typename T>
+static void read_list(TwiliReader& reader, T& list, void (*read_item)(TwiliReader&, typename T::value_type&))
+{
+  uint64_t count = reader.read_number();
+
+  for (uint64_t i = 0 ; i < count ; ++i)
+    read_item(reader, list.emplace_back());
+}
+
+static void write_string(TwiliWriter& writer, const string& value) { writer.write_string(value); }
+static void read_string(TwiliReader& reader, string& value) { value = reader.read_string(); }
+
+static void write_template_parameter(TwiliWriter& writer, const TemplateParameter& parameter)
+{
+  writer.write_string(parameter.type);
+  writer.write_string(parameter.name);
+  writer.write_string(parameter.default_value);
+}
+
+static void read_template_parameter(TwiliReader& reader, TemplateParameter& parameter)
+{
+  parameter.type = reader.read_string();
+  parameter.name = reader.read_string();
+  parameter.default_value = reader.read_string();
+}
+
+static void write_type(TwiliWriter& writer, const TypeDefinition& type)
+{
+  writer.write_string(type.raw_name);
+  writer.write_string(type.name);
+  write_list(writer, type.scopes, &write_string);
+  write_list(writer, type.declaration_scope, &write_string);
+  writer.write_number(type.kind);
+  writer.write_string(type.type_full_name);
+  writer.write_flag(type.is_const);
+  writer.write_number(type.is_reference);
+  writer.write_number(type.is_pointer);
+}
+
+static void read_type(TwiliReader& reader, TypeDefinition& type)
+{
+  type.raw_name = reader.read_string();
+  type.name = reader.read_string();
+  read_list(reader, type.scopes, &read_string);
+  read_list(reader, type.declaration_scope, &read_string);
+  type.kind = static_cast<TypeKind>(reader.read_number());
+  type.type_full_name = reader.read_string();
+  type.is_const = reader.read_flag();
+  type.is_reference = reader.read_number();
+  type.is_pointer = reader.read_number();
+}
+
+static void write_param(TwiliWriter& writer, const ParamDefinition& param)
+{
+  writer.write_string(param);
+  writer.write_flag(param.is_const);
+  writer.write_number(param.is_reference);
+  writer.write_number(param.is_pointer);
+  writer.write_string(param.name);
+  writer.write_string(param.type_alias);
+  writer.write_flag(param.unresolved_type.has_value());
+  if (param.unresolved_type)
+    write_type(writer, *param.unresolved_type);
+  writer.write_flag(param.is_symbolic);
+}
+
+static void read_param(TwiliReader& reader, ParamDefinition& param)
+{
+  param.assign(reader.read_string());
+  param.is_const = reader.read_flag();
+  param.is_reference = reader.read_number();
+  param.is_pointer = reader.read_number();
+  param.name = reader.read_string();
+  param.type_alias = reader.read_string();
+  if (reader.read_flag())
+    read_type(reader, param.unresolved_type.emplace());
+  param.is_symbolic = reader.read_flag();
+}
+
+static void write_layout(TwiliWriter& writer, const LayoutDefinition& layout)
+{
+  writer.write_signed(layout.size);
+  writer.write_signed(layout.alignment);
+  writer.write_signed(layout.offset);
+  writer.write_signed(layout.bit_width);
+}
+
+static void read_layout(TwiliReader& reader, LayoutDefinition& layout)
+{
+  layout.size = reader.read_signed();
+  layout.alignment = reader.read_signed();
+  layout.offset = reader.read_signed();
+  layout.bit_width = reader.read_signed();
+}
+
+static void write_field(TwiliWriter& writer, const FieldDefinition& field)
+{
+  write_param(writer, field);
+  writer.write_flag(field.is_static);
+  writer.write_string(field.visibility);
+  write_layout(writer, field.layout);
+  writer.write_number(field.configurations);
+}
+
+static void read_field(TwiliReader& reader, FieldDefinition& field)
+{
+  read_param(reader, field);
+  field.is_static = reader.read_flag();
+  field.visibility = reader.read_string();
+  read_layout(reader, field.layout);
+  field.configurations = reader.read_number();
+}
+
+static void write_invokable(TwiliWriter& writer, const InvokableDefinition& invokable)
+{
+  writer.write_flag(invokable.return_type.has_value());
+  if (invokable.return_type)
+    write_param(writer, *invokable.return_type);
+  write_list(writer, invokable.params, &write_param);
+  write_list(writer, invokable.template_parameters, &write_template_parameter);
+  writer.write_flag(invokable.is_variadic);
+}
+
+static void read_invokable(TwiliReader& reader, InvokableDefinition& invokable)
+{
+  if (reader.read_flag())
+    read_param(reader, invokable.return_type.emplace());
+  read_list(reader, invokable.params, &read_param);
+  read_list(reader, invokable.template_parameters, &read_template_parameter);
+  invokable.is_variadic = reader.read_flag();
+}
+
+static void write_method(TwiliWriter& writer, const MethodDefinition& method)
+{
+  write_invokable(writer, method);
+  writer.write_flag(method.is_static);
+  writer.write_flag(method.is_virtual);
+  writer.write_flag(method.is_pure_virtual);
+  writer.write_flag(method.is_const);
+  writer.write_flag(method.is_defaulted);
+  writer.write_flag(method.is_deleted);
+  writer.write_flag(method.is_final);
+  writer.write_flag(method.is_override);
+  writer.write_string(method.name);
+  writer.write_string(method.visibility);
+  writer.write_number(method.special_member);
+  writer.write_number(method.ref_qualifier);
+  writer.write_signed(method.exception_specification);
+  writer.write_number(method.configurations);
+}
+
+static void read_method(TwiliReader& reader, MethodDefinition& method)
+{
+  read_invokable(reader, method);
+  method.is_static = reader.read_flag();
+  method.is_virtual = reader.read_flag();
+  method.is_pure_virtual = reader.read_flag();
+  method.is_const = reader.read_flag();
+  method.is_defaulted = reader.read_flag();
+  method.is_deleted = reader.read_flag();
+  method.is_final = reader.read_flag();
+  method.is_override = reader.read_flag();
+  method.name = reader.read_string();
+  method.visibility = reader.read_string();
+  method.special_member = static_cast<SpecialMemberKind>(reader.read_number());
+  method.ref_qualifier = static_cast<CXRefQualifierKind>(reader.read_number());
+  method.exception_specification = static_cast<CXCursor_ExceptionSpecificationKind>(reader.read_signed());
+  method.configurations = reader.read_number();
+}
+
+static void write_function(TwiliWriter& writer, const FunctionDefinition& function)
+{
+  write_invokable(writer, function);
+  writer.write_string(function.name);
+  writer.write_string(function.full_name);
+  writer.write_string(function.from_file);
+  writer.write_string(function.include_path);
+  writer.write_number(function.configurations);
+}
+
+static void read_function(TwiliReader& reader, FunctionDefinition& function)
+{
+  read_invokable(reader, function);
+  function.name = reader.read_string();
+  function.full_name = reader.read_string();
+  function.from_file = reader.read_string();
+  function.include_path = reader.read_string();
+  function.configurations = reader.read_number();
+}
+
+static void write_namespace(TwiliWriter& writer, const NamespaceDefinition& ns)
+{
+  writer.write_string(ns.name);
+  writer.write_string(ns.full_name);
+}
+
+static void read_namespace(TwiliReader& reader, NamespaceDefinition& ns)
+{
+  ns.name = reader.read_string();
+  ns.full_name = reader.read_string();
+}
+
+static void write_class(TwiliWriter& writer, const ClassDefinition& klass)
+{
+  write_namespace(writer, klass);
+  writer.write_string(klass.type);
+  writer.write_string(klass.from_file);
+  writer.write_string(klass.include_path);
+  write_list(writer, klass.bases, &write_string);
+  write_list(writer, klass.known_bases, &write_string);
+  write_list(writer, klass.constructors, &write_method);
+  write_list(writer, klass.methods, &write_method);
+  write_list(writer, klass.fields, &write_field);
+  write_list(writer, klass.template_parameters, &write_template_parameter);
+  write_layout(writer, klass.layout);
+  writer.write_flag(klass.is_trivially_copyable);
+  writer.write_flag(klass.is_standard_layout);
+  writer.write_flag(klass.is_final);
+  writer.write_flag(klass.has_definition);
+  writer.write_number(klass.configurations);
+}
+
+static void read_class(TwiliReader& reader, ClassDefinition& klass)
+{
+  read_namespace(reader, klass);
+  klass.type = reader.read_string();
+  klass.from_file = reader.read_string();
+  klass.include_path = reader.read_string();
+  read_list(reader, klass.bases, &read_string);
+  read_list(reader, klass.known_bases, &read_string);
+  read_list(reader, klass.constructors, &read_method);
+  read_list(reader, klass.methods, &read_method);
+  read_list(reader, klass.fields, &read_field);
+  read_list(reader, klass.template_parameters, &read_template_parameter);
+  read_layout(reader, klass.layout);
+  klass.is_trivially_copyable = reader.read_flag();
+  klass.is_standard_layout = reader.read_flag();
+  klass.is_final = reader.read_flag();
+  klass.has_definition = reader.read_flag();
+  klass.configurations = reader.read_number();
+}
+
+static void write_enum(TwiliWriter& writer, const EnumDefinition& definition)
+{
+  writer.write_string(definition.name);
+  writer.write_string(definition.full_name);
+  writer.write_string(definition.from_file);
+  writer.write_string(definition.include_path);
+  writer.write_string(definition.visibility);
+  writer.write_number(definition.flags.size());
+  for (const auto& flag : definition.flags)
+  {
+    writer.write_string(flag.first);
+    writer.write_signed(flag.second);
+  }
+  writer.write_number(definition.configurations);
+}
+
+static void read_enum(TwiliReader& reader, EnumDefinition& definition)
+{
+  uint64_t count;
+
+  definition.name = reader.read_string();
+  definition.full_name = reader.read_string();
+  definition.from_file = reader.read_string();
+  definition.include_path = reader.read_string();
+  definition.visibility = reader.read_string();
+  count = reader.read_number();
+  for (uint64_t i = 0 ; i < count ; ++i)
+  {
+    string name = reader.read_string();
+
+    definition.flags.push_back({name, reader.read_signed()});
+  }
+  definition.configurations = reader.read_number();
+}
+
+static void write_diagnostic(TwiliWriter& writer, const TwiliDiagnostic& diagnostic)
+{
+  writer.write_number(diagnostic.severity);
+  writer.write_string(diagnostic.file);
+  writer.write_number(diagnostic.line);
+  writer.write_number(diagnostic.column);
+  writer.write_number(diagnostic.category);
+  writer.write_string(diagnostic.category_name);
+  writer.write_string(diagnostic.message);
+}
+
+static void read_diagnostic(TwiliReader& reader, TwiliDiagnostic& diagnostic)
+{
+  diagnostic.severity = static_cast<CXDiagnosticSeverity>(reader.read_number());
+  diagnostic.file = reader.read_string();
+  diagnostic.line = reader.read_number();
+  diagnostic.column = reader.read_number();
+  diagnostic.category = reader.read_number();
+  diagnostic.category_name = reader.read_string();
+  diagnostic.message = reader.read_string();
+}
+
+static void write_header(TwiliWriter& writer, const HeaderDefinition& header)
+{
+  writer.write_string(header.path);
+  writer.write_number(header.size);
+  write_list(writer, header.includes, &write_string);
+}
+
+static void read_header(TwiliReader& reader, HeaderDefinition& header)
+{
+  header.path = reader.read_string();
+  header.size = reader.read_number();
+  read_list(reader, header.includes, &read_string);
+}
+
+void serialize(TwiliWriter& writer, const TwiliParser& parser)
+{
+  vector<HeaderDefinition> headers;
+
+  for (const auto& entry : parser.get_headers())
+    headers.push_back(entry.second);
+  write_list(writer, parser.get_namespaces(), &write_namespace);
+  write_list(writer, parser.get_types(), &write_type);
+  write_list(writer, parser.get_classes(), &write_class);
+  write_list(writer, parser.get_enums(), &write_enum);
+  write_list(writer, parser.get_functions(), &write_function);
+  write_list(writer, headers, &write_header);
+}
+
+void deserialize(TwiliReader& reader, TwiliParser& parser)
+{
+  vector<NamespaceDefinition> namespaces;
+  vector<TypeDefinition> types;
+  vector<ClassDefinition> classes;
+  vector<EnumDefinition> enums;
+  vector<FunctionDefinition> functions;
+  vector<HeaderDefinition> headers;
+
+  read_list(reader, namespaces, &read_namespace);
+  read_list(reader, types, &read_type);
+  read_list(reader, classes, &read_class);
+  read_list(reader, enums, &read_enum);
+  read_list(reader, functions, &read_function);
+  read_list(reader, headers, &read_header);
+  for (const auto& ns : namespaces) parser.add_namespace(ns);
+  for (const auto& type : types) parser.add_type(type);
+  for (const auto& klass : classes) parser.add_class(klass);
+  for (const auto& definition : enums) parser.add_enum(definition);
+  for (const auto& function : functions) parser.add_function(function);
+  for (const auto& header : headers) parser.add_header(header);
+}
+
+void serialize(TwiliWriter& writer, const TwiliFileReport& report)
+{
+  writer.write_string(report.path);
+  writer.write_flag(report.parsed);
+  writer.write_number(report.error_code);
+  writer.write_number(report.error_count);
+  writer.write_number(report.warning_count);
+  write_list(writer, report.diagnostics, &write_diagnostic);
+  writer.write_flag(report.errors_expected);
+  writer.write_flag(report.skipped);
+}
+
+void deserialize(TwiliReader& reader, TwiliFileReport& report)
+{
+  report.path = reader.read_string();
+  report.parsed = reader.read_flag();
+  report.error_code = static_cast<CXErrorCode>(reader.read_number());
+  report.error_count = reader.read_number();
+  report.warning_count = reader.read_number();
+  read_list(reader, report.diagnostics, &read_diagnostic);
+  report.errors_expected = reader.read_flag();
+  report.skipped = reader.read_flag();
+}
+
+string serialize_model(const TwiliParser& parser)
+{
+  TwiliWriter writer;
+
+  writer.write_string(model_header);
+  serialize(writer, parser);
+  return writer.str();
+}
+
+void deserialize_model(string_view data, TwiliParser& parser)
+{
+  TwiliReader reader(data);
+
+  if (reader.read_string() != model_header)
+    throw runtime_error("deserialize_model: unsupported model format");
+  deserialize(reader, parser);
+}
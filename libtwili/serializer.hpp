@@ -0,0 +1,40 @@
+#pragma once
+#include "parser.hpp"
+#include "diagnostics.hpp"
+#include <cstdint>
+#include <string_view>
+
+// Compact binary encoding of the model: numbers are stored as varints and
+// strings are length-prefixed.
+class TwiliWriter
+{
+  std::string buffer;
+public:
+  void write_number(std::uint64_t value);
+  void write_signed(std::int64_t value);
+  void write_flag(bool value) { buffer += static_cast<char>(value ? 1 : 0); }
+  void write_string(std::string_view value);
+  const std::string& str() const { return buffer; }
+};
+
+class TwiliReader
+{
+  std::string_view data;
+  std::size_t      position = 0;
+public:
+  TwiliReader(std::string_view data) : data(data) {}
+
+  std::uint64_t read_number();
+  std::int64_t  read_signed();
+  bool          read_flag();
+  std::string   read_string();
+  bool          at_end() const { return position >= data.size(); }
+};
+
+void serialize(TwiliWriter&, const TwiliParser&);
+void serialize(TwiliWriter&, const TwiliFileReport&);
+void deserialize(TwiliReader&, TwiliParser&);
+void deserialize(TwiliReader&, TwiliFileReport&);
+
+std::string serialize_model(const TwiliParser&);
+void        deserialize_model(std::string_view data, TwiliParser&);
@@ -0,0 +1,320 @@
+#include "sharded_runner.hpp"
+#include "serializer.hpp"
+#include "output.hpp"
+#include <stdexcept>
+#if defined(__unix__) || defined(__APPLE__)
+# define TWILI_HAS_WORKER_PROCESSES
+# include <sys/types.h>
+# include <sys/wait.h>
+# include <sys/resource.h>
+# include <unistd.h>
+# include <poll.h>
+# include <signal.h>
+# include <cerrno>
+# include <deque>
+# include <optional>
+# include <iostream>
+#endif
+
+using namespace std;
+
+#ifdef TWILI_HAS_WORKER_PROCESSES
+
+static const char file_started_message = 'B';
+static const char file_done_message = 'R';
+static const size_t message_header_size = 9;
+
+struct ShardWorker
+{
+  pid_t                            pid = -1;
+  int                              fd = -1;
+  bool                             closed = false;
+  bool                             timed_out = false;
+  string                           buffer;
+  deque<size_t>                    pending;
+  optional<size_t>                 current;
+  chrono::steady_clock::time_point started_at;
+};
+
+static void write_all(int fd, const string& data)
+{
+  size_t written = 0;
+
+  while (written < data.size())
+  {
+    ssize_t result = write(fd, data.data() + written, data.size() - written);
+
+    if (result < 0 && errno != EINTR)
+      _exit(2);
+    else if (result > 0)
+      written += result;
+  }
+}
+
+// Messages are made of a one byte type, a 64-bit little-endian body length
+// and the body itself, which starts with the index of the file it refers to.
+static void send_message(int fd, char type, size_t index, const string& payload = "")
+{
+  TwiliWriter body;
+  string message(1, type);
+
+  body.write_number(index);
+  message.reserve(message_header_size + body.str().size() + payload.size());
+  for (int i = 0 ; i < 8 ; ++i)
+    message += static_cast<char>(((body.str().size() + payload.size()) >> (i * 8)) & 0xff);
+  write_all(fd, message + body.str() + payload);
+}
+
+static void run_worker(int fd, const TwiliParser& parser, const vector<filesystem::path>& files, const deque<size_t>& indexes, const TwiliShardOptions& options, int argc, const char** argv)
+{
+  if (options.memory_limit > 0)
+  {
+    struct rlimit limit{options.memory_limit, options.memory_limit};
+
+    setrlimit(RLIMIT_AS, &limit);
+  }
+  TwiliRunOptions run_options = options.run_options;
+
+  run_options.resolve_types = false;
+  run_options.record_inclusions = options.run_options.record_inclusions || !options.run_options.depfile_path.empty();
+  run_options.output_path.clear();
+  run_options.depfile_path.clear();
+  for (size_t index : indexes)
+  {
+    TwiliParser file_parser;
+    TwiliRunReport report;
+    TwiliWriter writer;
+
+    for (const string& directory : parser.get_directories())
+      file_parser.add_directory(directory);
+    file_parser.set_filter(parser.get_filter());
+    file_parser.set_handlers(parser.get_handlers());
+    file_parser.set_deferred_resolution(parser.has_deferred_resolution());
+    file_parser.set_detail_level(parser.get_detail_level());
+    file_parser.set_verbose(parser.is_verbose());
+    send_message(fd, file_started_message, index);
+    report = run_parser(file_parser, {files[index]}, run_options, argc, argv);
+    serialize(writer, report.files.front());
+    serialize(writer, file_parser);
+    send_message(fd, file_done_message, index, writer.str());
+  }
+}
+
+static ShardWorker spawn_worker(deque<size_t> indexes, const TwiliParser& parser, const vector<filesystem::path>& files, const TwiliShardOptions& options, int argc, const char** argv)
+{
+  ShardWorker worker;
+  int fds[2];
+
+  if (pipe(fds) != 0)
+    throw runtime_error("run_sharded_parser: could not create pipe");
+  cout.flush();
+  cerr.flush();
+  worker.pid = fork();
+  if (worker.pid < 0)
+    throw runtime_error("run_sharded_parser: could not fork worker");
+  if (worker.pid == 0)
+  {
+    close(fds[0]);
+    try
+    {
+      run_worker(fds[1], parser, files, indexes, options, argc, argv);
+    }
+    catch (...)
+    {
+      _exit(1);
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  worker.fd = fds[0];
+  worker.pending = std::move(indexes);
+  return worker;
+}
+
+static void read_messages(ShardWorker& worker, vector<optional<string>>& results, TwiliScanMonitor* monitor)
+{
+  while (worker.buffer.size() >= message_header_size)
+  {
+    uint64_t length = 0;
+    string body;
+
+    for (int i = 0 ; i < 8 ; ++i)
+      length |= static_cast<uint64_t>(static_cast<unsigned char>(worker.buffer[1 + i])) << (i * 8);
+    if (worker.buffer.size() < message_header_size + length)
+      break ;
+    body = worker.buffer.substr(message_header_size, length);
+    if (worker.buffer[0] == file_started_message)
+    {
+      TwiliReader reader(body);
+
+      worker.current = reader.read_number();
+      worker.started_at = chrono::steady_clock::now();
+    }
+    else if (worker.buffer[0] == file_done_message)
+    {
+      TwiliReader reader(body);
+      size_t index = reader.read_number();
+
+      results[index] = std::move(body);
+      if (monitor)
+        monitor->files_done.fetch_add(1, memory_order_relaxed);
+      worker.pending.erase(std::find(worker.pending.begin(), worker.pending.end(), index));
+      worker.current.reset();
+    }
+    worker.buffer.erase(0, message_header_size + length);
+  }
+}
+
+static void read_worker(ShardWorker& worker, vector<optional<string>>& results, TwiliScanMonitor* monitor)
+{
+  char chunk[65536];
+  ssize_t count = read(worker.fd, chunk, sizeof(chunk));
+
+  if (count > 0)
+  {
+    worker.buffer.append(chunk, count);
+    read_messages(worker, results, monitor);
+  }
+  else if (count == 0 || errno != EINTR)
+    worker.closed = true;
+}
+
+static string describe_exit(const ShardWorker& worker, int status)
+{
+  if (worker.timed_out)
+    return "worker exceeded the time limit";
+  if (WIFSIGNALED(status))
+    return "worker was killed by signal " + to_string(WTERMSIG(status));
+  return "worker exited with status " + to_string(WEXITSTATUS(status));
+}
+
+TwiliRunReport run_sharded_parser(TwiliParser& parser, const vector<filesystem::path>& files, const TwiliShardOptions& options, int argc, const char** argv)
+{
+  TwiliRunReport report;
+  vector<optional<string>> results(files.size());
+  vector<TwiliFileReport> crashes(files.size());
+  vector<unsigned int> attempts(files.size(), 0);
+  vector<ShardWorker> workers;
+  unsigned int worker_count = max(1u, options.worker_count);
+  TwiliScanMonitor* monitor = parser.get_monitor();
+
+  for (unsigned int w = 0 ; w < worker_count && w < files.size() ; ++w)
+  {
+    deque<size_t> indexes;
+
+    for (size_t i = w ; i < files.size() ; i += worker_count)
+      indexes.push_back(i);
+    workers.push_back(spawn_worker(indexes, parser, files, options, argc, argv));
+  }
+  if (monitor)
+    monitor->files_total.store(files.size(), memory_order_relaxed);
+  while (workers.size() > 0)
+  {
+    vector<pollfd> fds;
+    vector<ShardWorker> respawned;
+    chrono::steady_clock::time_point now;
+
+    for (const auto& worker : workers)
+      fds.push_back({worker.fd, POLLIN, 0});
+    poll(fds.data(), fds.size(), 100);
+    if (monitor && monitor->cancelled.load(memory_order_relaxed))
+    {
+      for (auto& worker : workers)
+      {
+        kill(worker.pid, SIGKILL);
+        waitpid(worker.pid, nullptr, 0);
+        close(worker.fd);
+      }
+      report.cancelled = true;
+      break ;
+    }
+    now = chrono::steady_clock::now();
+    for (size_t i = 0 ; i < workers.size() ; ++i)
+    {
+      ShardWorker& worker = workers[i];
+
+      if (fds[i].revents & (POLLIN | POLLHUP | POLLERR))
+        read_worker(worker, results, monitor);
+      if (!worker.closed && worker.current && now - worker.started_at > options.file_timeout)
+      {
+        kill(worker.pid, SIGKILL);
+        worker.timed_out = worker.closed = true;
+      }
+    }
+    for (auto& worker : workers)
+    {
+      int status = 0;
+      optional<size_t> culprit;
+
+      if (!worker.closed)
+        continue ;
+      waitpid(worker.pid, &status, 0);
+      close(worker.fd);
+      culprit = worker.current;
+      if (!culprit && worker.pending.size() > 0)
+        culprit = worker.pending.front(); // died before reaching its first file
+      if (culprit)
+      {
+        size_t index = *culprit;
+
+        worker.pending.erase(std::find(worker.pending.begin(), worker.pending.end(), index));
+        if (++attempts[index] <= options.retries)
+          worker.pending.push_front(index);
+        else
+        {
+          TwiliFileReport& crash = crashes[index];
+          TwiliDiagnostic diagnostic;
+
+          crash.path = files[index].string();
+          crash.error_code = CXError_Crashed;
+          diagnostic.severity = CXDiagnostic_Fatal;
+          diagnostic.file = crash.path;
+          diagnostic.message = describe_exit(worker, status);
+          crash.diagnostics.push_back(diagnostic);
+          if (monitor)
+            monitor->files_done.fetch_add(1, memory_order_relaxed);
+          if (options.run_options.verbose)
+            cerr << "\r/!\\ Failed to parse file " << crash.path << ": " << diagnostic.message << endl;
+        }
+      }
+      if (worker.pending.size() > 0)
+        respawned.push_back(spawn_worker(worker.pending, parser, files, options, argc, argv));
+    }
+    workers.erase(remove_if(workers.begin(), workers.end(), [](const ShardWorker& worker) { return worker.closed; }), workers.end());
+    for (auto& worker : respawned)
+      workers.push_back(std::move(worker));
+  }
+  for (size_t i = 0 ; i < files.size() ; ++i)
+  {
+    if (results[i])
+    {
+      TwiliReader reader(*results[i]);
+      TwiliFileReport& file_report = report.files.emplace_back();
+
+      reader.read_number();
+      deserialize(reader, file_report);
+      deserialize(reader, parser);
+    }
+    else if (crashes[i].path.length() > 0) // files left over by a cancelled scan have no report
+      report.files.push_back(crashes[i]);
+  }
+  if (options.run_options.resolve_types && !report.cancelled)
+    report.unresolved_types = parser.resolve_types();
+  if (options.run_options.verbose && (!report.success() || report.unresolved_types.size() > 0))
+    cerr << '\r' << report.summary() << endl;
+  if (!report.cancelled)
+    write_run_outputs(parser, report, options.run_options);
+  return report;
+}
+
+#else
+TwiliRunReport run_sharded_parser(TwiliParser&, const vector<filesystem::path>&, const TwiliShardOptions&, int, const char**)
+{
+  throw runtime_error("run_sharded_parser: worker processes are not supported on this platform");
+}
+#endif
+
+TwiliRunReport probe_and_run_sharded_parser(TwiliParser& parser, const TwiliShardOptions& options, int argc, const char** argv)
+{
+  return run_sharded_parser(parser, probe_files(parser), options, argc, argv);
+}
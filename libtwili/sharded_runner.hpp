@@ -0,0 +1,22 @@
+#pragma once
+#include "runner.hpp"
+#include <chrono>
+
+struct TwiliShardOptions
+{
+  unsigned int              worker_count = 4;
+  std::chrono::milliseconds file_timeout{std::chrono::minutes(5)};
+  std::size_t               memory_limit = 0; // address space cap per worker, in bytes (0 disables it)
+  unsigned int              retries = 1;
+  TwiliRunOptions           run_options;
+};
+
+// Parses the files in forked worker processes, each with its own TwiliParser.
+// Workers stream their results back through pipes, and the results are merged
+// into `parser` in file order. A worker which crashes, times out or exceeds its
+// memory limit only costs the file it was parsing, which gets retried in a new
+// worker before being reported as failed.
+// Workers are forked, which is only supported on POSIX systems: elsewhere,
+// it throws a std::runtime_error.
+TwiliRunReport run_sharded_parser(TwiliParser&, const std::vector<std::filesystem::path>&, const TwiliShardOptions&, int argc = 0, const char** argv = nullptr);
+TwiliRunReport probe_and_run_sharded_parser(TwiliParser&, const TwiliShardOptions&, int argc = 0, const char** argv = nullptr);
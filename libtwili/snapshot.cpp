@@ -0,0 +1,321 @@
+#include "snapshot.hpp"
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+static string scoped_name(const string& scope, const string& name)
+{
+  if (scope == "::")
+    return scope + name;
+  return scope + "::" + name;
+}
+
+static string signature_of(const string& name, const InvokableDefinition& invokable)
+{
+  string result = name + '(';
+
+  for (size_t i = 0 ; i < invokable.params.size() ; ++i)
+  {
+    if (i > 0)
+      result += ',';
+    result += invokable.params[i].to_string();
+  }
+  if (invokable.is_variadic)
+    result += invokable.params.size() ? ",..." : "...";
+  return result + ')';
+}
+
+static TwiliHash hash_invokable(const InvokableDefinition& invokable, TwiliHash hash = twili_hash_seed)
+{
+  if (invokable.return_type)
+    hash = twili_hash(invokable.return_type->to_string(), hash);
+  for (const auto& parameter : invokable.template_parameters)
+  {
+    hash = twili_hash(parameter.type, hash);
+    hash = twili_hash(parameter.name, hash);
+    hash = twili_hash(parameter.default_value, hash);
+  }
+  return hash;
+}
+
+static string method_key(const MethodDefinition& method)
+{
+  string key = signature_of(method.name, method);
+
+  if (method.is_const)
+    key += " const";
+  if (method.ref_qualifier == CXRefQualifier_LValue)
+    key += " &";
+  else if (method.ref_qualifier == CXRefQualifier_RValue)
+    key += " &&";
+  return key;
+}
+
+static TwiliHash hash_method(const MethodDefinition& method)
+{
+  string flags;
+
+  flags += method.is_static ? 's' : '-';
+  flags += method.is_virtual ? 'v' : '-';
+  flags += method.is_pure_virtual ? 'p' : '-';
+  flags += method.is_final ? 'f' : '-';
+  flags += method.is_override ? 'o' : '-';
+  flags += method.is_deleted ? 'd' : '-';
+  flags += method.is_defaulted ? 'D' : '-';
+  flags += std::to_string(method.exception_specification);
+  return hash_invokable(method, twili_hash(method.visibility + flags));
+}
+
+static TwiliHash hash_layout(const LayoutDefinition& layout, TwiliHash hash)
+{
+  if (layout.is_known() || layout.offset >= 0)
+  {
+    hash = twili_hash_combine(hash, static_cast<TwiliHash>(layout.offset));
+    hash = twili_hash_combine(hash, static_cast<TwiliHash>(layout.size));
+    hash = twili_hash_combine(hash, static_cast<TwiliHash>(layout.bit_width));
+  }
+  return hash;
+}
+
+static TwiliHash hash_field(const FieldDefinition& field)
+{
+  return hash_layout(field.layout, twili_hash(field.visibility + (field.is_static ? " static " : " ") + field.to_string()));
+}
+
+template<typename VALUE>
+static TwiliHash hash_entries(const map<string, VALUE>& entries, TwiliHash hash)
+{
+  for (const auto& entry : entries)
+  {
+    hash = twili_hash(entry.first, hash);
+    if constexpr (is_integral_v<VALUE>)
+      hash = twili_hash_combine(hash, static_cast<TwiliHash>(entry.second));
+    else
+      hash = twili_hash_combine(hash, entry.second.hash);
+  }
+  return hash;
+}
+
+static ClassSnapshot make_class_snapshot(const ClassDefinition& klass)
+{
+  ClassSnapshot snapshot;
+  TwiliHash hash = twili_hash(klass.type);
+
+  for (const auto& base : klass.bases)
+    hash = twili_hash(base, hash);
+  for (const auto& parameter : klass.template_parameters)
+    hash = twili_hash(parameter.name + '=' + parameter.default_value, hash);
+  // the field map is sorted by name: reordering fields only shows here
+  for (const auto& field : klass.fields)
+  {
+    if (!field.is_static)
+      hash = twili_hash(field.name, hash);
+  }
+  hash = hash_layout(klass.layout, hash);
+  snapshot.declaration_hash = hash;
+  for (const auto& constructor : klass.constructors)
+    snapshot.methods.emplace(method_key(constructor), hash_method(constructor));
+  for (const auto& method : klass.methods)
+    snapshot.methods.emplace(method_key(method), hash_method(method));
+  for (const auto& field : klass.fields)
+    snapshot.fields.emplace(field.name, hash_field(field));
+  return snapshot;
+}
+
+static EnumSnapshot make_enum_snapshot(const EnumDefinition& definition)
+{
+  EnumSnapshot snapshot;
+
+  for (const auto& flag : definition.flags)
+    snapshot.values.emplace(flag.first, flag.second);
+  snapshot.hash = hash_entries(snapshot.values, twili_hash_seed);
+  return snapshot;
+}
+
+// Nested classes get hashed before their enclosing class.
+static void hash_class(ClassSnapshot& snapshot)
+{
+  for (auto& entry : snapshot.classes)
+    hash_class(entry.second);
+  snapshot.hash = hash_entries(snapshot.fields, hash_entries(snapshot.methods, snapshot.declaration_hash));
+  if (snapshot.classes.size() > 0)
+    snapshot.hash = hash_entries(snapshot.classes, twili_hash("classes", snapshot.hash));
+  if (snapshot.enums.size() > 0)
+    snapshot.hash = hash_entries(snapshot.enums, twili_hash("enums", snapshot.hash));
+}
+
+ApiSnapshot::ApiSnapshot(const TwiliParser& parser)
+{
+  vector<ClassDefinition> classes = parser.get_classes();
+  map<string, ClassSnapshot*> class_snapshots;
+
+  // enclosing classes have shorter names, and get registered first
+  stable_sort(classes.begin(), classes.end(), [](const ClassDefinition& a, const ClassDefinition& b)
+  {
+    return a.full_name.length() < b.full_name.length();
+  });
+  for (const auto& ns : parser.get_namespaces())
+    namespaces.emplace(ns.full_name, NamespaceSnapshot());
+  for (const auto& klass : classes)
+  {
+    auto parent = class_snapshots.find(klass.cpp_context());
+    auto& siblings = parent != class_snapshots.end() ? parent->second->classes : namespaces[klass.cpp_context()].classes;
+    auto inserted = siblings.emplace(klass.name, make_class_snapshot(klass));
+
+    class_snapshots.emplace(klass.full_name, &inserted.first->second);
+  }
+  for (const auto& definition : parser.get_enums())
+  {
+    string scope = scope_of(definition.full_name);
+    auto parent = class_snapshots.find(scope);
+    auto& siblings = parent != class_snapshots.end() ? parent->second->enums : namespaces[scope].enums;
+
+    siblings.emplace(definition.name, make_enum_snapshot(definition));
+  }
+  for (const auto& function : parser.get_functions())
+    namespaces[function.cpp_context()].functions.emplace(signature_of(function.name, function), hash_invokable(function));
+  hash = twili_hash_seed;
+  for (auto& entry : namespaces)
+  {
+    NamespaceSnapshot& ns = entry.second;
+
+    for (auto& klass : ns.classes)
+      hash_class(klass.second);
+    ns.hash = twili_hash("classes");
+    ns.hash = hash_entries(ns.classes, ns.hash);
+    ns.hash = hash_entries(ns.enums, twili_hash("enums", ns.hash));
+    ns.hash = hash_entries(ns.functions, twili_hash("functions", ns.hash));
+  }
+  hash = hash_entries(namespaces, hash);
+}
+
+// Walks two sorted maps side by side, reporting entries found on one side
+// only, and handing entries found on both sides to `on_both`.
+template<typename MAP, typename ON_SIDE, typename ON_BOTH>
+static void compare_entries(const MAP& before, const MAP& after, ON_SIDE on_side, ON_BOTH on_both)
+{
+  auto a = before.begin();
+  auto b = after.begin();
+
+  while (a != before.end() || b != after.end())
+  {
+    if (b == after.end() || (a != before.end() && a->first < b->first))
+      on_side(ApiChange::Removed, *(a++));
+    else if (a == before.end() || b->first < a->first)
+      on_side(ApiChange::Added, *(b++));
+    else
+    {
+      on_both(a->first, a->second, b->second);
+      ++a;
+      ++b;
+    }
+  }
+}
+
+template<typename VALUE>
+static void compare_members(vector<ApiChange>& changes, ApiChange::Subject subject, const string& scope, const map<string, VALUE>& before, const map<string, VALUE>& after)
+{
+  compare_entries(before, after,
+    [&](ApiChange::Action action, const pair<const string, VALUE>& entry)
+    {
+      changes.push_back({action, subject, scope, entry.first});
+    },
+    [&](const string& key, const VALUE& a, const VALUE& b)
+    {
+      if (a != b)
+        changes.push_back({ApiChange::Changed, subject, scope, key});
+    }
+  );
+}
+
+static void report_namespace(vector<ApiChange>& changes, ApiChange::Action action, const string& full_name, const NamespaceSnapshot& ns)
+{
+  changes.push_back({action, ApiChange::NamespaceSubject, "", full_name});
+  for (const auto& entry : ns.classes)
+    changes.push_back({action, ApiChange::ClassSubject, full_name, entry.first});
+  for (const auto& entry : ns.enums)
+    changes.push_back({action, ApiChange::EnumSubject, full_name, entry.first});
+  for (const auto& entry : ns.functions)
+    changes.push_back({action, ApiChange::FunctionSubject, full_name, entry.first});
+}
+
+static void compare_enums(vector<ApiChange>& changes, const string& scope, const map<string, EnumSnapshot>& before, const map<string, EnumSnapshot>& after)
+{
+  compare_entries(before, after,
+    [&](ApiChange::Action action, const pair<const string, EnumSnapshot>& entry)
+    {
+      changes.push_back({action, ApiChange::EnumSubject, scope, entry.first});
+    },
+    [&](const string& name, const EnumSnapshot& a, const EnumSnapshot& b)
+    {
+      if (a.hash != b.hash)
+        compare_members(changes, ApiChange::EnumValueSubject, scoped_name(scope, name), a.values, b.values);
+    }
+  );
+}
+
+static void compare_classes(vector<ApiChange>& changes, const string& scope, const map<string, ClassSnapshot>& before, const map<string, ClassSnapshot>& after)
+{
+  compare_entries(before, after,
+    [&](ApiChange::Action action, const pair<const string, ClassSnapshot>& entry)
+    {
+      changes.push_back({action, ApiChange::ClassSubject, scope, entry.first});
+    },
+    [&](const string& name, const ClassSnapshot& a, const ClassSnapshot& b)
+    {
+      string class_name = scoped_name(scope, name);
+
+      if (a.hash == b.hash)
+        return ;
+      if (a.declaration_hash != b.declaration_hash)
+        changes.push_back({ApiChange::Changed, ApiChange::ClassSubject, scope, name});
+      compare_members(changes, ApiChange::MethodSubject, class_name, a.methods, b.methods);
+      compare_members(changes, ApiChange::FieldSubject, class_name, a.fields, b.fields);
+      compare_classes(changes, class_name, a.classes, b.classes);
+      compare_enums(changes, class_name, a.enums, b.enums);
+    }
+  );
+}
+
+static void compare_namespaces(vector<ApiChange>& changes, const string& scope, const NamespaceSnapshot& before, const NamespaceSnapshot& after)
+{
+  compare_classes(changes, scope, before.classes, after.classes);
+  compare_enums(changes, scope, before.enums, after.enums);
+  compare_members(changes, ApiChange::FunctionSubject, scope, before.functions, after.functions);
+}
+
+vector<ApiChange> diff_snapshots(const ApiSnapshot& before, const ApiSnapshot& after)
+{
+  vector<ApiChange> changes;
+
+  if (before.hash != after.hash)
+  {
+    compare_entries(before.namespaces, after.namespaces,
+      [&](ApiChange::Action action, const pair<const string, NamespaceSnapshot>& entry)
+      {
+        report_namespace(changes, action, entry.first, entry.second);
+      },
+      [&](const string& full_name, const NamespaceSnapshot& a, const NamespaceSnapshot& b)
+      {
+        if (a.hash != b.hash)
+          compare_namespaces(changes, full_name, a, b);
+      }
+    );
+  }
+  return changes;
+}
+
+string ApiChange::to_string() const
+{
+  static const char* action_symbols[] = {"+", "-", "~"};
+  static const char* subject_names[] = {"namespace", "class", "method", "field", "enum", "enum value", "function"};
+  stringstream stream;
+
+  stream << action_symbols[action] << ' ' << subject_names[subject] << ' ';
+  if (subject == NamespaceSubject)
+    stream << name;
+  else
+    stream << scoped_name(scope, name);
+  return stream.str();
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "parser.hpp"
+#include "hash.hpp"
+#include <map>
+
+// Content hashes computed bottom-up over the model. Members are keyed by
+// their signature, so that two snapshots can be compared by only
+// descending into the subtrees whose hashes differ.
+struct EnumSnapshot
+{
+  TwiliHash                        hash = 0;
+  std::map<std::string, long long> values;
+};
+
+// Nested classes and enums are kept in their enclosing class.
+struct ClassSnapshot
+{
+  TwiliHash                            hash = 0;
+  TwiliHash                            declaration_hash = 0;
+  std::map<std::string, TwiliHash>     methods;
+  std::map<std::string, TwiliHash>     fields;
+  std::map<std::string, ClassSnapshot> classes;
+  std::map<std::string, EnumSnapshot>  enums;
+};
+
+struct NamespaceSnapshot
+{
+  TwiliHash                            hash = 0;
+  std::map<std::string, ClassSnapshot> classes;
+  std::map<std::string, EnumSnapshot>  enums;
+  std::map<std::string, TwiliHash>     functions;
+};
+
+struct ApiSnapshot
+{
+  TwiliHash                                hash = 0;
+  std::map<std::string, NamespaceSnapshot> namespaces;
+
+  ApiSnapshot() {}
+  ApiSnapshot(const TwiliParser&);
+};
+
+struct ApiChange
+{
+  enum Action
+  {
+    Added,
+    Removed,
+    Changed
+  };
+
+  enum Subject
+  {
+    NamespaceSubject,
+    ClassSubject,
+    MethodSubject,
+    FieldSubject,
+    EnumSubject,
+    EnumValueSubject,
+    FunctionSubject
+  };
+
+  Action      action;
+  Subject     subject;
+  std::string scope;
+  std::string name;
+
+  std::string to_string() const;
+};
+
+std::vector<ApiChange> diff_snapshots(const ApiSnapshot& before, const ApiSnapshot& after);
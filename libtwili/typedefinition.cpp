@@ -6,11 +6,17 @@ using namespace std;
 
 string cxStringToStdString(const CXString&);
 
-TypeDefinition& TypeDefinition::load_from(CXType type, const std::vector<TypeDefinition>& known_types)
+TypeDefinition& TypeDefinition::load_from(CXType type, const std::vector<TypeDefinition>&)
 {
-  string spelt = cxStringToStdString(clang_getTypeSpelling(type));
-
-  return load_from(spelt, known_types);
+  TypeReference reference(type);
+
+  raw_name = reference.to_string();
+  name = reference.unqualified_name();
+  scopes = reference.scopes;
+  is_const = reference.is_const;
+  is_pointer = reference.pointer_count();
+  is_reference = reference.reference_count();
+  return *this;
 }
 
 std::string parse_template_parameter(int& i, const std::string& src, const std::vector<TypeDefinition>& known_types)
@@ -143,7 +149,16 @@ std::string TypeDefinition::solve_type(const std::vector<TypeDefinition>& known_
 
   if (match)
     return match->type_full_name;
-  return Crails::join(scopes, "") + "::" + name;
+  return scoped_name();
+}
+
+std::string TypeDefinition::scoped_name() const
+{
+  std::string result;
+
+  for (const string& scope : scopes)
+    result += "::" + scope;
+  return result + "::" + name;
 }
 
 std::string TypeDefinition::to_string() const
@@ -152,7 +167,7 @@ std::string TypeDefinition::to_string() const
 
   if (is_const)
     result += "const ";
-  result += Crails::join(scopes, "::") + "::" + name;
+  result += scoped_name();
   for (int i = 0 ; i < is_pointer ; ++i)
     result += '*';
   for (int i = 0 ; i < is_reference ; ++i)
@@ -0,0 +1,369 @@
+#include "definitions.hpp"
+#include <map>
+#include <optional>
+
+using namespace std;
+
+string cxStringToStdString(const CXString&);
+
+static const map<CXTypeKind, string> builtin_names{
+  {CXType_Void,       "void"},
+  {CXType_Bool,       "bool"},
+  {CXType_Char_U,     "char"},
+  {CXType_Char_S,     "char"},
+  {CXType_SChar,      "signed char"},
+  {CXType_UChar,      "unsigned char"},
+  {CXType_WChar,      "wchar_t"},
+  {CXType_Char16,     "char16_t"},
+  {CXType_Char32,     "char32_t"},
+  {CXType_UShort,     "unsigned short"},
+  {CXType_UInt,       "unsigned int"},
+  {CXType_ULong,      "unsigned long"},
+  {CXType_ULongLong,  "unsigned long long"},
+  {CXType_UInt128,    "unsigned __int128"},
+  {CXType_Short,      "short"},
+  {CXType_Int,        "int"},
+  {CXType_Long,       "long"},
+  {CXType_LongLong,   "long long"},
+  {CXType_Int128,     "__int128"},
+  {CXType_Float,      "float"},
+  {CXType_Double,     "double"},
+  {CXType_LongDouble, "long double"},
+  {CXType_NullPtr,    "std::nullptr_t"}
+};
+
+const string* builtin_type_name(CXTypeKind kind)
+{
+  auto it = builtin_names.find(kind);
+
+  return it != builtin_names.end() ? &it->second : nullptr;
+}
+
+bool is_builtin_type_name(const string& name)
+{
+  for (const auto& entry : builtin_names)
+  {
+    if (entry.second == name)
+      return true;
+  }
+  return name == "signed" || name == "unsigned" || name == "signed int" || name == "short int" || name == "long int";
+}
+
+static void load_scopes(CXCursor declaration, vector<string>& scopes)
+{
+  CXCursor parent = clang_getCursorSemanticParent(declaration);
+
+  while (!clang_Cursor_isNull(parent) && parent.kind != CXCursor_TranslationUnit)
+  {
+    switch (parent.kind)
+    {
+      case CXCursor_Namespace:
+        if (clang_Cursor_isInlineNamespace(parent))
+          break ;
+        [[fallthrough]];
+      case CXCursor_StructDecl:
+      case CXCursor_ClassDecl:
+      case CXCursor_UnionDecl:
+      case CXCursor_ClassTemplate:
+      case CXCursor_ClassTemplatePartialSpecialization:
+      {
+        string name = cxStringToStdString(clang_getCursorSpelling(parent));
+
+        if (name.length())
+          scopes.insert(scopes.begin(), name);
+        break ;
+      }
+      case CXCursor_LinkageSpec:
+        break ;
+      default: // function-local declaration
+        return ;
+    }
+    parent = clang_getCursorSemanticParent(parent);
+  }
+}
+
+static bool is_declarator_type(CXTypeKind kind)
+{
+  switch (kind)
+  {
+    case CXType_FunctionProto:
+    case CXType_FunctionNoProto:
+    case CXType_ConstantArray:
+    case CXType_IncompleteArray:
+    case CXType_VariableArray:
+    case CXType_DependentSizedArray:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the function or array type found below the pointer and reference
+// layers of `type`, if there is one.
+static optional<CXType> find_declarator_type(CXType type)
+{
+  for (;;)
+  {
+    if (type.kind == CXType_Elaborated)
+      type = clang_Type_getNamedType(type);
+    else if (type.kind == CXType_Pointer || type.kind == CXType_LValueReference || type.kind == CXType_RValueReference)
+      type = clang_getPointeeType(type);
+    else
+      return is_declarator_type(type.kind) ? optional<CXType>(type) : optional<CXType>();
+  }
+}
+
+// Splits the last template argument list of a spelled type, such as
+// `&ns::config` and `3` in `ns::Tuned<&ns::config, 3>`.
+static vector<string> spelled_template_arguments(const string& spelling)
+{
+  vector<string> arguments;
+  size_t end = spelling.rfind('>');
+  size_t start;
+  int depth = 0;
+
+  if (end == string::npos)
+    return arguments;
+  for (start = end ; start > 0 ; --start)
+  {
+    char c = spelling[start];
+
+    if (c == '>' || c == ')' || c == ']')
+      depth++;
+    else if ((c == '<' || c == '(' || c == '[') && --depth == 0)
+      break ;
+  }
+  depth = 0;
+  for (size_t i = start + 1, begin = i ; i <= end ; ++i)
+  {
+    char c = spelling[i];
+
+    if (c == '<' || c == '(' || c == '[')
+      depth++;
+    else if ((c == '>' || c == ')' || c == ']') && i < end)
+      depth--;
+    else if (i == end || (c == ',' && depth == 0))
+    {
+      size_t first = spelling.find_first_not_of(' ', begin);
+
+      arguments.push_back(first < i ? spelling.substr(first, i - first) : string());
+      begin = i + 1;
+    }
+  }
+  return arguments;
+}
+
+// Values are spelled as in clang's spelling of the canonical type, which
+// qualifies names and evaluates expressions, as in `ns::Mode::Slow` or `3`.
+// Packs are expanded in both the spelling and the argument count.
+static TypeReference make_template_value(CXType type, int index, optional<vector<string>>& spelled_arguments)
+{
+  TypeReference value;
+
+  if (!spelled_arguments)
+    spelled_arguments = spelled_template_arguments(cxStringToStdString(clang_getTypeSpelling(clang_getCanonicalType(type))));
+  if (static_cast<size_t>(index) < spelled_arguments->size() && (*spelled_arguments)[index].length() > 0)
+    value.name = (*spelled_arguments)[index];
+  else
+    value.name = "...";
+  return value;
+}
+
+// Spells a function type from its result and parameter types, so that
+// their names get qualified, wrapping the pointer and reference layers
+// found above it, as in `void (*)(const ::geo::Point&)`.
+static string spell_function_type(CXType type)
+{
+  string declarator;
+  string result;
+  int argument_count;
+
+  while (type.kind != CXType_FunctionProto)
+  {
+    if (type.kind == CXType_Elaborated)
+      type = clang_Type_getNamedType(type);
+    else
+    {
+      if (type.kind == CXType_Pointer)
+        declarator = (clang_isConstQualifiedType(type) ? "* const" : "*") + declarator;
+      else
+        declarator = (type.kind == CXType_LValueReference ? "&" : "&&") + declarator;
+      type = clang_getPointeeType(type);
+    }
+  }
+  result = TypeReference(clang_getResultType(type)).to_string() + ' ';
+  if (declarator.length() > 0)
+    result += '(' + declarator + ')';
+  result += '(';
+  argument_count = clang_getNumArgTypes(type);
+  for (int i = 0 ; i < argument_count ; ++i)
+    result += (i > 0 ? ", " : "") + TypeReference(clang_getArgType(type, i)).to_string();
+  if (clang_isFunctionTypeVariadic(type))
+    result += argument_count > 0 ? ", ..." : "...";
+  result += ')';
+  if (clang_getExceptionSpecificationType(type) == CXCursor_ExceptionSpecificationKind_BasicNoexcept)
+    result += " noexcept";
+  return result;
+}
+
+TypeReference::TypeReference(CXType type)
+{
+  // pointers and references wrap around function and array types, as in
+  // `void (*)(int)`: such types are kept whole, and arrays are spelled by
+  // clang
+  if (auto declarator_type = find_declarator_type(type))
+  {
+    kind = declarator_type->kind;
+    if (kind == CXType_FunctionProto)
+      name = spell_function_type(type);
+    else
+      name = cxStringToStdString(clang_getTypeSpelling(type));
+    return ;
+  }
+  for (;;)
+  {
+    if (type.kind == CXType_Elaborated)
+    {
+      is_const = is_const || clang_isConstQualifiedType(type);
+      type = clang_Type_getNamedType(type);
+    }
+    else if (type.kind == CXType_Pointer || type.kind == CXType_LValueReference || type.kind == CXType_RValueReference)
+    {
+      if (layer_count < max_layers)
+      {
+        layers[layer_count].kind = type.kind == CXType_Pointer ? PointerLayer
+          : (type.kind == CXType_LValueReference ? LValueReferenceLayer : RValueReferenceLayer);
+        layers[layer_count].is_const = clang_isConstQualifiedType(type);
+        layer_count++;
+      }
+      type = clang_getPointeeType(type);
+    }
+    else
+      break ;
+  }
+  kind = type.kind;
+  is_const = is_const || clang_isConstQualifiedType(type);
+  if (const string* builtin = builtin_type_name(kind))
+    name = *builtin;
+  else
+  {
+    CXCursor declaration = clang_getTypeDeclaration(type);
+
+    if (!clang_Cursor_isNull(declaration) && declaration.kind != CXCursor_NoDeclFound)
+    {
+      bool is_alias = declaration.kind == CXCursor_TypedefDecl || declaration.kind == CXCursor_TypeAliasDecl;
+      int argument_count = is_alias ? 0 : clang_Type_getNumTemplateArguments(type);
+      optional<vector<string>> spelled_arguments;
+
+      name = cxStringToStdString(clang_getCursorSpelling(declaration));
+      if (declaration.kind != CXCursor_TemplateTypeParameter)
+        load_scopes(declaration, scopes);
+      for (int i = 0 ; i < argument_count ; ++i)
+      {
+        CXType argument = clang_Type_getTemplateArgumentAsType(type, i);
+
+        if (argument.kind != CXType_Invalid)
+          template_arguments.emplace_back(argument);
+        else
+          template_arguments.push_back(make_template_value(type, i, spelled_arguments));
+      }
+    }
+    if (name.length() == 0 || name.find(' ') != string::npos) // anonymous or undeclared types
+    {
+      static const string const_prefix("const ");
+
+      name = cxStringToStdString(clang_getTypeSpelling(type));
+      if (name.find(const_prefix) == 0)
+        name = name.substr(const_prefix.length());
+      scopes.clear();
+      template_arguments.clear();
+    }
+  }
+}
+
+bool TypeReference::is_builtin() const
+{
+  return builtin_type_name(kind) != nullptr;
+}
+
+bool TypeReference::is_spelled() const
+{
+  return is_declarator_type(kind);
+}
+
+int TypeReference::pointer_count() const
+{
+  int count = 0;
+
+  for (unsigned char i = 0 ; i < layer_count ; ++i)
+    count += layers[i].kind == PointerLayer ? 1 : 0;
+  return count;
+}
+
+int TypeReference::reference_count() const
+{
+  int count = 0;
+
+  for (unsigned char i = 0 ; i < layer_count ; ++i)
+  {
+    if (layers[i].kind == LValueReferenceLayer)
+      count += 1;
+    else if (layers[i].kind == RValueReferenceLayer)
+      count += 2;
+  }
+  return count;
+}
+
+string TypeReference::unqualified_name() const
+{
+  string result = name;
+
+  if (template_arguments.size() > 0)
+  {
+    result += '<';
+    for (size_t i = 0 ; i < template_arguments.size() ; ++i)
+    {
+      if (i > 0)
+        result += ", ";
+      result += template_arguments[i].to_string();
+    }
+    result += '>';
+  }
+  return result;
+}
+
+string TypeReference::full_name() const
+{
+  string result;
+
+  if (kind == CXType_Invalid || is_builtin() || is_spelled())
+    return unqualified_name();
+  for (const string& scope : scopes)
+    result += "::" + scope;
+  return result + "::" + unqualified_name();
+}
+
+string TypeReference::to_string() const
+{
+  string result;
+
+  if (is_const)
+    result += "const ";
+  result += full_name();
+  for (int i = layer_count - 1 ; i >= 0 ; --i)
+  {
+    switch (layers[i].kind)
+    {
+      case PointerLayer:
+        result += layers[i].is_const ? "* const" : "*";
+        break ;
+      case LValueReferenceLayer:
+        result += '&';
+        break ;
+      case RValueReferenceLayer:
+        result += "&&";
+        break ;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+namespace models
+{
+  struct Pod;
+  class Widget;
+
+  struct Handle
+  {
+    Pod*    pod;
+    Widget* widget;
+  };
+
+  void release(Pod*);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace models
+{
+  struct Pod
+  {
+    int    id;
+    double weight;
+    char   tag;
+  };
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "b_pod.hpp"
+
+namespace models
+{
+  class Widget
+  {
+  public:
+    virtual ~Widget();
+    virtual void draw() const = 0;
+    Pod pod() const;
+  protected:
+    Pod state;
+  };
+
+  class Button : public Widget
+  {
+  public:
+    void draw() const override;
+    void click();
+  };
+}
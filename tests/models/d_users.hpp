@@ -0,0 +1,17 @@
+#pragma once
+#include "a_forward.hpp"
+#include "c_widget.hpp"
+
+namespace models
+{
+  struct Pod;
+
+  struct Inventory
+  {
+    Pod     first;
+    Handle  handle;
+    Button* button;
+  };
+
+  Inventory make_inventory(const Pod&);
+}
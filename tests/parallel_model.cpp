@@ -0,0 +1,109 @@
+#include <libtwili/parallel_runner.hpp>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+static const char* clang_arguments[] = {"-x", "c++", "-std=c++17"};
+
+// Everything which should not depend on the scan order nor on how files
+// are spread across threads, with classes sorted by name.
+static string describe(const TwiliParser& parser, const filesystem::path& directory)
+{
+  vector<ClassDefinition> classes = parser.get_classes();
+  vector<string> functions;
+  stringstream stream;
+
+  sort(classes.begin(), classes.end(), [](const ClassDefinition& a, const ClassDefinition& b) { return a.full_name < b.full_name; });
+  for (const auto& klass : classes)
+  {
+    stream << klass.type << ' ' << klass.full_name
+           << " from " << filesystem::path(klass.from_file).lexically_relative(directory).generic_string()
+           << " definition=" << klass.has_definition
+           << " size=" << klass.layout.size << " alignment=" << klass.layout.alignment
+           << " trivially_copyable=" << klass.is_trivially_copyable << " standard_layout=" << klass.is_standard_layout << '\n';
+    for (const auto& base : klass.bases)
+      stream << "  base " << base << '\n';
+    for (const auto& field : klass.fields)
+      stream << "  field " << field.to_string() << ' ' << field.name << " offset=" << field.layout.offset << '\n';
+    for (const auto& method : klass.methods)
+      stream << "  method " << method.name << (method.is_pure_virtual ? " pure" : "") << '\n';
+  }
+  for (const auto& function : parser.get_functions())
+  {
+    string signature = function.full_name + '(';
+
+    for (const auto& param : function.params)
+      signature += param.to_string() + ',';
+    functions.push_back(signature + ')');
+  }
+  sort(functions.begin(), functions.end());
+  for (const string& function : functions)
+    stream << "function " << function << '\n';
+  return stream.str();
+}
+
+static string scan(const filesystem::path& directory, TwiliDetailLevel level, vector<filesystem::path> files, unsigned int thread_count)
+{
+  TwiliParser parser;
+  TwiliRunReport report;
+
+  parser.set_verbose(false);
+  parser.set_detail_level(level);
+  parser.add_directory(directory.string());
+  if (thread_count == 0)
+  {
+    TwiliRunOptions options;
+
+    options.verbose = false;
+    report = run_parser(parser, files, options, 3, clang_arguments);
+  }
+  else
+  {
+    TwiliParallelOptions options;
+
+    options.thread_count = thread_count;
+    options.run_options.verbose = false;
+    report = run_parallel_parser(parser, files, options, 3, clang_arguments);
+  }
+  if (!report.success())
+    return "(!) scan failed: " + report.summary();
+  return describe(parser, directory);
+}
+
+int main(int argc, char** argv)
+{
+  filesystem::path directory = argc > 1 ? argv[1] : "models";
+  TwiliParser prober;
+  vector<filesystem::path> files;
+  int failures = 0;
+
+  prober.add_directory(directory.string());
+  files = probe_files(prober);
+  sort(files.begin(), files.end());
+  for (TwiliDetailLevel level : {InventoryLevel, FullLevel})
+  {
+    string expected = scan(directory, level, files, 0);
+    vector<filesystem::path> reversed(files.rbegin(), files.rend());
+
+    for (unsigned int thread_count : {0u, 1u, 2u, 3u, 8u})
+    {
+      for (const auto* order : {&files, &reversed})
+      {
+        string result = scan(directory, level, *order, thread_count);
+
+        if (result != expected)
+        {
+          cerr << "(!) level " << level << ", " << thread_count << " threads, "
+               << (order == &files ? "sorted" : "reversed") << " files:\n"
+               << result << "-- expected:\n" << expected << endl;
+          failures++;
+        }
+      }
+    }
+  }
+  if (failures == 0)
+    cout << "parallel and sequential models match" << endl;
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,43 @@
+#include <libtwili/prefilter.hpp>
+#include <iostream>
+
+using namespace std;
+
+struct PrefilterCase
+{
+  const char* source;
+  bool        may_declare;
+};
+
+static const PrefilterCase cases[] = {
+  {"int x;\nextern int y;\nint v = 3;\n", false},
+  {"int f /* comment */ (int);\n", true},
+  {"#define X(a) a\nint z;\n", false},
+  // Included files which aren't scanned on their own
+  {"#pragma once\n#include \"detail/foo.inl\"\n", true},
+  {"#include \"detail/foo.ipp\"\n", true},
+  {"# include <generated/list.def>\n", true},
+  {"#include \"forward\"\n", true},
+  {"#include HEADER_NAME\n", true},
+  {"#ifndef GUARD\n#define GUARD\n#include \"real.hpp\"\n#include <vector>\n#endif\n", false},
+  // X-macros: the included header declares names built from the macro
+  {"#define NAME Foo\n#include \"template.h\"\n#undef NAME\n", true},
+  {"#define ENTRY(name) int name;\n#include \"entries.h\"\n", true},
+  {"#define VERSION 1\n#include <vector>\n", false}
+};
+
+int main()
+{
+  int failures = 0;
+
+  for (const PrefilterCase& entry : cases)
+  {
+    if (may_declare_symbols(string_view(entry.source)) != entry.may_declare)
+    {
+      cerr << "(!) expected " << (entry.may_declare ? "a possible declaration" : "no declaration")
+           << " in:" << endl << entry.source << endl;
+      failures++;
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
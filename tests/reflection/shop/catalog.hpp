@@ -0,0 +1,53 @@
+#pragma once
+
+namespace shop
+{
+  enum class Currency { Euro, Dollar };
+
+  template<typename T>
+  struct Box
+  {
+    struct Handle { int index; };
+    enum State { Empty, Full };
+    T content;
+  };
+
+  template<int Size, bool Sorted>
+  struct FixedList
+  {
+    int items[Size];
+  };
+
+  extern const char default_label[];
+
+  template<const char* Label>
+  struct Labelled { };
+
+  class Product
+  {
+    struct Cache { int hits; };
+    enum Flag { Dirty, Clean };
+  protected:
+    struct Audit { int revision; };
+  public:
+    struct Price
+    {
+      Currency currency;
+      long     cents;
+    };
+    enum Kind { Book, Food };
+
+    Price                   price;
+    Kind                    kind;
+    Labelled<default_label> label;
+    FixedList<4, true>      tags;
+    void (*on_change)(const Price&);
+
+    Cache* cache();
+    Flag   flag() const;
+    Audit* audit();
+    Price  discounted(int percent) const;
+    void   visit(Kind (*visitor)(Price, Currency));
+    Labelled<default_label> relabel();
+  };
+}
@@ -0,0 +1,54 @@
+#include <libtwili/runner.hpp>
+#include <libtwili/reflection_emitter.hpp>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+static const char* clang_arguments[] = {"-x", "c++", "-std=c++17"};
+
+// Renders the reflection headers for the headers of a directory, then has
+// the compiler check a source file including all of them.
+int main(int argc, char** argv)
+{
+  filesystem::path directory = argc > 1 ? argv[1] : "reflection";
+  string compiler = argc > 2 ? argv[2] : "c++";
+  filesystem::path output = filesystem::temp_directory_path() / "twili-reflection-compile";
+  TwiliParser parser;
+  TwiliRunOptions options;
+  TwiliRunReport report;
+  string command;
+  int status;
+
+  options.verbose = false;
+  parser.set_verbose(false);
+  parser.add_directory(directory.string());
+  report = probe_and_run_parser(parser, options, 3, clang_arguments);
+  if (!report.success())
+  {
+    cerr << "(!) scan failed: " << report.summary() << endl;
+    return 1;
+  }
+  filesystem::remove_all(output);
+  TwiliReflectionEmitter(parser).write(output);
+  {
+    ofstream source(output / "main.cpp");
+
+    for (const auto& entry : filesystem::recursive_directory_iterator(output))
+    {
+      if (entry.path().filename() == "reflection.hpp")
+        source << "#include \"" << entry.path().lexically_relative(output).generic_string() << "\"\n";
+    }
+    source << "int main() { return 0; }\n";
+  }
+  command = compiler + " -std=c++17 -fsyntax-only"
+          + " -I\"" + output.string() + "\" -I\"" + directory.string() + "\""
+          + " \"" + (output / "main.cpp").string() + '"';
+  status = system(command.c_str());
+  if (status != 0)
+    cerr << "(!) generated headers don't compile: " << command << endl;
+  else
+    filesystem::remove_all(output);
+  return status == 0 ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include <libtwili/registry.hpp>
+#include <thread>
+#include <random>
+#include <iostream>
+
+using namespace std;
+
+struct Entry
+{
+  size_t       key_index;
+  unsigned int thread_index;
+};
+
+static int failures = 0;
+
+static void check(bool condition, const string& message)
+{
+  if (!condition)
+  {
+    cerr << "(!) " << message << endl;
+    failures++;
+  }
+}
+
+static vector<string> make_keys(size_t count)
+{
+  vector<string> keys;
+
+  for (size_t i = 0 ; i < count ; ++i)
+    keys.push_back("::namespace_" + to_string(i % 97) + "::Type" + to_string(i));
+  return keys;
+}
+
+// Threads insert the same keys in their own order while others keep looking
+// them up: each key must be won by exactly one thread, and every thread must
+// then see the winner's value, whether through insert or find.
+static void check_racing_inserts(unsigned int thread_count, size_t bucket_count, const vector<string>& keys)
+{
+  TwiliConcurrentRegistry<Entry> registry(bucket_count);
+  vector<vector<const Entry*>> seen(thread_count, vector<const Entry*>(keys.size()));
+  vector<thread> threads;
+  atomic<size_t> inserted{0};
+  atomic<size_t> inconsistencies{0};
+  atomic<bool> done{false};
+  thread reader([&]()
+  {
+    mt19937 random(thread_count);
+
+    while (!done.load(memory_order_acquire))
+    {
+      size_t i = random() % keys.size();
+      const Entry* entry = registry.find(keys[i]);
+
+      if (entry && entry->key_index != i)
+        inconsistencies++;
+    }
+  });
+
+  for (unsigned int t = 0 ; t < thread_count ; ++t)
+  {
+    threads.emplace_back([&, t]()
+    {
+      vector<size_t> order(keys.size());
+
+      for (size_t i = 0 ; i < order.size() ; ++i)
+        order[i] = i;
+      shuffle(order.begin(), order.end(), mt19937(t));
+      for (size_t i : order)
+      {
+        auto result = registry.insert(keys[i], Entry{i, t});
+
+        inserted += result.second ? 1 : 0;
+        seen[t][i] = result.first;
+        if (result.first->key_index != i || (result.second && result.first->thread_index != t))
+          inconsistencies++;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  done.store(true, memory_order_release);
+  reader.join();
+
+  string context = to_string(thread_count) + " threads, " + to_string(bucket_count) + " buckets: ";
+
+  check(inserted == keys.size(), context + to_string(inserted) + " inserts won for " + to_string(keys.size()) + " keys");
+  check(registry.size() == keys.size(), context + "size() is " + to_string(registry.size()));
+  check(registry.values().size() == keys.size(), context + "values() lists " + to_string(registry.values().size()) + " entries");
+  check(inconsistencies == 0, context + to_string(inconsistencies) + " entries didn't match their key or inserter");
+  for (size_t i = 0 ; i < keys.size() ; ++i)
+  {
+    const Entry* entry = registry.find(keys[i]);
+
+    for (unsigned int t = 0 ; t < thread_count ; ++t)
+    {
+      if (seen[t][i] != entry)
+      {
+        check(false, context + "thread " + to_string(t) + " saw another value for " + keys[i]);
+        return ;
+      }
+    }
+  }
+}
+
+static void check_insertion_order(const vector<string>& keys)
+{
+  TwiliConcurrentRegistry<Entry> registry(16);
+  vector<const Entry*> values;
+
+  for (size_t i = 0 ; i < keys.size() ; ++i)
+    registry.insert(keys[i], Entry{i, 0});
+  check(!registry.insert(keys.front(), Entry{keys.size(), 0}).second, "inserting an existing key succeeded");
+  check(registry.find("::missing") == nullptr, "found a key which was never inserted");
+  values = registry.values();
+  for (size_t i = 0 ; i < values.size() ; ++i)
+  {
+    if (values[i]->key_index != i)
+    {
+      check(false, "values() doesn't follow the insertion order");
+      break ;
+    }
+  }
+}
+
+int main()
+{
+  const vector<string> keys = make_keys(20000);
+
+  check_insertion_order(keys);
+  check_racing_inserts(8, 1, make_keys(500)); // every insert contends for the same bucket
+  for (unsigned int thread_count : {2u, 8u, 32u})
+  {
+    for (size_t bucket_count : {size_t(64), keys.size()})
+      check_racing_inserts(thread_count, bucket_count, keys);
+  }
+  if (failures == 0)
+    cout << "TwiliConcurrentRegistry: all checks passed" << endl;
+  return failures == 0 ? 0 : 1;
+}